@@ -0,0 +1,76 @@
+#
+# Runs the host build through a fixed set of scenarios and compares a hash of
+# each frame trace with host/expected_traces.txt, so a change that alters what
+# the watchface draws, or when, shows up without comparing traces by hand.
+#
+# usage: check_traces.py [--update] [wiper-host binary]
+#
+# The binary defaults to build/host/wiper-host. --update rewrites the expected
+# file from the current build, for changes that mean to alter the output.
+#
+
+import hashlib
+import os
+import subprocess
+import sys
+
+EXPECTED_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'expected_traces.txt')
+
+# Name and WIPER_HOST_* settings of each scenario. Times are UTC.
+SCENARIOS = [
+    ('default', {}),
+    ('noon_12h', {'START': '1420113540', 'SECONDS': '300'}),
+    ('morning_24h', {'START': '1420106340', 'SECONDS': '300', '24H': '1'}),
+    ('disconnect', {'START': '1420113540', 'SECONDS': '90', 'DISCONNECT': '20'}),
+    ('late_timers', {'START': '1420113540', 'SECONDS': '120', 'TIMER_DELAY': '40'}),
+    ('notification', {'START': '1420113540', 'SECONDS': '180', 'UNFOCUS': '61', 'FOCUS': '90'}),
+    ('battery_low', {'START': '1420113540', 'SECONDS': '300', 'BATTERY': '20'}),
+    ('battery_empty', {'START': '1420113540', 'SECONDS': '300', 'BATTERY': '10'}),
+    ('battery_charging', {'START': '1420113540', 'SECONDS': '300', 'BATTERY': '10', 'CHARGING': '1'}),
+    ('quiet_hours', {'START': '1420153080', 'SECONDS': '600', 'PERSIST': '3=1,6=5'}),
+    ('flick', {'START': '1420113540', 'SECONDS': '200', 'PERSIST': '2=1', 'TAPS': '30,35,90'}),
+    ('flick_hour_apart', {'SECONDS': '3700', 'PERSIST': '2=1', 'TAPS': '30,3630'}),
+]
+
+
+def trace_hash(binary, settings):
+    env = {'PATH': os.environ.get('PATH', ''), 'TZ': 'UTC', 'WIPER_HOST_TRACE': '1'}
+    for name, value in settings.items():
+        env['WIPER_HOST_' + name] = value
+
+    output = subprocess.run([binary], env=env, stdout=subprocess.PIPE, stderr=subprocess.DEVNULL,
+                            check=True).stdout.decode()
+    frames = [line for line in output.splitlines() if line.startswith('frame ')]
+    return '%s %d' % (hashlib.md5('\n'.join(frames).encode()).hexdigest(), len(frames))
+
+
+def main(args):
+    update = '--update' in args
+    args = [arg for arg in args if arg != '--update']
+    binary = args[0] if args else os.path.join('build', 'host', 'wiper-host')
+
+    results = [(name, trace_hash(binary, settings)) for name, settings in SCENARIOS]
+    if update:
+        with open(EXPECTED_PATH, 'w') as f:
+            f.write(''.join('%s %s\n' % result for result in results))
+        print('updated %s' % EXPECTED_PATH)
+        return 0
+
+    expected = {}
+    with open(EXPECTED_PATH) as f:
+        for line in f:
+            name, value = line.split(' ', 1)
+            expected[name] = value.strip()
+
+    failures = 0
+    for name, value in results:
+        status = 'ok' if expected.get(name) == value else 'FAIL'
+        if status == 'FAIL':
+            failures += 1
+        print('%-18s %s  %s (expected %s)' % (name, status, value, expected.get(name, 'nothing')))
+
+    return 1 if failures > 0 else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,65 @@
+#
+# Generates the resource table for the host build from appinfo.json, the same
+# way the Pebble SDK assigns RESOURCE_ID_* values: in media list order,
+# starting at 1. Bitmaps are packed 1-bit, LSB first, with 4-byte aligned rows.
+#
+# usage: gen_resources.py <appinfo.json> <resources dir> <out header> <out source>
+#
+
+import json
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools'))
+from pngdecode import load_png
+
+
+def pack_rows(image):
+    row_size = ((image.width + 31) // 32) * 4
+    data = bytearray()
+    for row in image.pixels:
+        packed = bytearray(row_size)
+        for x, white in enumerate(row):
+            if white:
+                packed[x // 8] |= 1 << (x % 8)
+        data += packed
+    return row_size, data
+
+
+def main(appinfo_path, resources_dir, header_path, source_path):
+    with open(appinfo_path) as f:
+        media = json.load(f)['resources']['media']
+
+    header = ['#pragma once', '// Generated by host/gen_resources.py. Do not edit.', '',
+              'typedef enum {', '  INVALID_RESOURCE = 0,']
+    source = ['// Generated by host/gen_resources.py. Do not edit.',
+              '#include <pebble.h>', '']
+    entries = []
+
+    for index, item in enumerate(media):
+        resource_id = index + 1
+        name = 'RESOURCE_ID_' + item['name']
+        header.append('  %s = %d,' % (name, resource_id))
+        if item['type'] != 'png':
+            continue
+
+        image = load_png(os.path.join(resources_dir, item['file']))
+        row_size, data = pack_rows(image)
+        symbol = '_resource_%d' % resource_id
+        source.append('static const uint8_t %s[] = {' % symbol)
+        for offset in range(0, len(data), 16):
+            source.append('  ' + ', '.join('0x%02x' % b for b in data[offset:offset + 16]) + ',')
+        source.append('};')
+        entries.append('  { %d, %d, %d, %d, %s },' % (resource_id, image.width, image.height, row_size, symbol))
+
+    header += ['} AppResourceId;', '']
+    source += ['', 'const HostResource g_host_resources[] = {'] + entries + ['  { 0, 0, 0, 0, NULL }', '};', '']
+
+    with open(header_path, 'w') as f:
+        f.write('\n'.join(header))
+    with open(source_path, 'w') as f:
+        f.write('\n'.join(source))
+
+
+if __name__ == '__main__':
+    main(*sys.argv[1:5])
@@ -0,0 +1,1767 @@
+// Host implementation of the Pebble SDK subset declared in host/pebble.h.
+//
+// The event loop runs on a simulated clock: timers and tick events fire in
+// timestamp order without sleeping, and the window is re-rendered into a
+// 144x168 1-bit framebuffer after every event that dirtied a layer, the same
+// way the firmware redraws the whole window. Each callback and update proc is
+// timed so hot paths can be profiled without a watch.
+//
+// Environment:
+//   WIPER_HOST_START    start time, seconds since the epoch (default 2015-01-01 10:09:00)
+//   WIPER_HOST_SECONDS  simulated run length in seconds (default 180)
+//   WIPER_HOST_24H      1 to use 24 hour time style
+//   WIPER_HOST_BATTERY  battery charge percent (default 80)
+//   WIPER_HOST_CHARGING 1 to report the battery as charging and plugged in
+//   WIPER_HOST_HEAP     heap size in bytes used for the headroom report (default 24576)
+//   WIPER_HOST_TRACE    1 to print a hash of every rendered frame to stdout
+//   WIPER_HOST_FRAMES   directory to write every rendered frame to as PBM
+//   WIPER_HOST_DISCONNECT  seconds into the run to report bluetooth disconnected
+//   WIPER_HOST_TIMER_DELAY milliseconds every app timer fires late by, as on a busy watch
+//   WIPER_HOST_UNFOCUS  seconds into the run a notification covers the face
+//   WIPER_HOST_FOCUS    seconds into the run the notification is dismissed
+//   WIPER_HOST_TAPS     comma separated seconds into the run at which the wrist is flicked
+//   WIPER_HOST_PERSIST  comma separated key=value ints to start persistent storage with
+
+#define _GNU_SOURCE
+#include <pebble.h>
+#include <dlfcn.h>
+#include <math.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef time
+
+#define HOST_SCREEN_WIDTH 144
+#define HOST_SCREEN_HEIGHT 168
+#define HOST_FRAMEBUFFER_ROW_SIZE 20
+#define HOST_DEFAULT_START 1420106940
+#define HOST_DEFAULT_SECONDS 180
+#define HOST_DEFAULT_HEAP 24576
+#define HOST_MAX_PROFILE_ENTRIES 64
+#define HOST_MAX_PERSIST_KEYS 32
+#define HOST_MAX_TAPS 32
+
+#define BITMAP_FLAG_OWNS_DATA 1
+
+typedef enum { LAYER_PLAIN, LAYER_BITMAP, LAYER_ROT_BITMAP, LAYER_TEXT } LayerKind;
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  bool hidden;
+  bool clips;
+  LayerKind kind;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  size_t data_size;
+};
+
+struct BitmapLayer {
+  Layer layer;
+  const GBitmap *bitmap;
+  GColor background_color;
+  GCompOp compositing_mode;
+  GAlign alignment;
+};
+
+// Must keep bitmap as the second member like BitmapLayer. The watchface swaps
+// rotated bitmaps through bitmap_layer_set_bitmap, as the firmware allows.
+struct RotBitmapLayer {
+  Layer layer;
+  const GBitmap *bitmap;
+  GColor corner_clip_color;
+  int32_t rotation;
+  GPoint src_ic;
+  GPoint dest_ic;
+  GCompOp compositing_mode;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+  GFont font;
+  GColor text_color;
+  GColor background_color;
+  GTextAlignment alignment;
+  GTextOverflowMode overflow_mode;
+};
+
+struct Window {
+  Layer *root_layer;
+  GColor background_color;
+  WindowHandlers handlers;
+  bool loaded;
+  bool on_stack;
+};
+
+struct GContext {
+  GBitmap *dest;
+  GPoint offset;
+  GRect clip;
+  GColor stroke_color;
+  GColor fill_color;
+  GColor text_color;
+  GCompOp compositing_mode;
+  bool frame_buffer_captured;
+};
+
+struct AppTimer {
+  uint64_t fire_ms;
+  uint32_t sequence;
+  AppTimerCallback callback;
+  void *callback_data;
+  AppTimer *next;
+};
+
+struct HostFont {
+  const char *key;
+};
+
+// Padded to 16 bytes so allocations keep malloc's alignment.
+typedef struct {
+  uint64_t size;
+  uint64_t padding;
+} HeapHeader;
+
+typedef struct {
+  const void *fn;
+  const char *kind;
+  uint32_t calls;
+  uint64_t ns;
+} ProfileEntry;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t update_procs;
+  uint32_t timer_fires;
+  uint32_t ticks;
+  uint32_t draw_pixel;
+  uint32_t draw_line;
+  uint32_t draw_rect;
+  uint32_t draw_circle;
+  uint32_t draw_bitmap;
+  uint32_t draw_text;
+  uint32_t frame_buffer_captures;
+  uint64_t pixels_written;
+  uint64_t render_ns;
+  uint64_t callback_ns;
+} HostStats;
+
+static uint8_t _framebufferData[HOST_FRAMEBUFFER_ROW_SIZE * HOST_SCREEN_HEIGHT];
+static GBitmap _framebuffer = {
+  _framebufferData, HOST_FRAMEBUFFER_ROW_SIZE, 0, { {0, 0}, {HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT} }
+};
+
+static uint64_t _startMs;
+static uint64_t _nowMs;
+static uint64_t _lastTickMs;
+static uint64_t _endMs;
+static AppTimer *_timers = NULL;
+static uint32_t _timerSequence = 0;
+static uint32_t _timerDelayMs = 0;
+static Window *_topWindow = NULL;
+static bool _needsRender = false;
+static bool _rendering = false;
+
+static TimeUnits _tickUnits = 0;
+static TickHandler _tickHandler = NULL;
+static BluetoothConnectionHandler _bluetoothHandler = NULL;
+static bool _bluetoothConnected = true;
+static uint64_t _disconnectMs = UINT64_MAX;
+static BatteryStateHandler _batteryHandler = NULL;
+static AppFocusHandler _focusHandler = NULL;
+static uint64_t _unfocusMs = UINT64_MAX;
+static uint64_t _focusMs = UINT64_MAX;
+static AccelTapHandler _tapHandler = NULL;
+static uint64_t _tapMs[HOST_MAX_TAPS];
+static uint16_t _tapCount = 0;
+static uint16_t _nextTap = 0;
+
+static size_t _heapUsed = 0;
+static size_t _heapPeak = 0;
+static size_t _heapSize = HOST_DEFAULT_HEAP;
+static uint32_t _heapAllocations = 0;
+
+static uint32_t _persistKeys[HOST_MAX_PERSIST_KEYS];
+static int32_t _persistValues[HOST_MAX_PERSIST_KEYS];
+static uint16_t _persistCount = 0;
+
+static HostStats _stats;
+static ProfileEntry _profile[HOST_MAX_PROFILE_ENTRIES];
+static uint16_t _profileCount = 0;
+static bool _trace = false;
+static const char *_framesDir = NULL;
+
+static struct HostFont _fonts[] = {
+  { FONT_KEY_GOTHIC_14 }, { FONT_KEY_GOTHIC_14_BOLD }, { FONT_KEY_GOTHIC_18 },
+  { FONT_KEY_GOTHIC_18_BOLD }, { FONT_KEY_GOTHIC_24 }, { FONT_KEY_GOTHIC_24_BOLD }
+};
+
+static int32_t envInt(const char *name, int32_t defaultValue) {
+  const char *value = getenv(name);
+  return (value != NULL && *value != '\0') ? (int32_t) strtol(value, NULL, 10) : defaultValue;
+}
+
+static uint64_t cpuNanos(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static void profileRecord(const void *fn, const char *kind, uint64_t ns) {
+  for (int index = 0; index < _profileCount; index++) {
+    if (_profile[index].fn == fn) {
+      _profile[index].calls++;
+      _profile[index].ns += ns;
+      return;
+    }
+  }
+
+  if (_profileCount < HOST_MAX_PROFILE_ENTRIES) {
+    _profile[_profileCount++] = (ProfileEntry) { fn, kind, 1, ns };
+  }
+}
+
+//
+// Heap
+//
+void *host_malloc(size_t size) {
+  HeapHeader *header = malloc(sizeof(HeapHeader) + size);
+  if (header == NULL) {
+    return NULL;
+  }
+
+  header->size = size;
+  _heapUsed += size;
+  _heapAllocations++;
+  if (_heapUsed > _heapPeak) {
+    _heapPeak = _heapUsed;
+  }
+
+  return header + 1;
+}
+
+void *host_calloc(size_t count, size_t size) {
+  void *ptr = host_malloc(count * size);
+  if (ptr != NULL) {
+    memset(ptr, 0, count * size);
+  }
+
+  return ptr;
+}
+
+void host_free(void *ptr) {
+  if (ptr != NULL) {
+    HeapHeader *header = ((HeapHeader*) ptr) - 1;
+    _heapUsed -= header->size;
+    free(header);
+  }
+}
+
+void *host_realloc(void *ptr, size_t size) {
+  if (ptr == NULL) {
+    return host_malloc(size);
+  }
+
+  HeapHeader *header = ((HeapHeader*) ptr) - 1;
+  void *newPtr = host_malloc(size);
+  if (newPtr != NULL) {
+    memcpy(newPtr, ptr, (header->size < size) ? header->size : size);
+    host_free(ptr);
+  }
+
+  return newPtr;
+}
+
+size_t heap_bytes_used(void) {
+  return _heapUsed;
+}
+
+size_t heap_bytes_free(void) {
+  return (_heapUsed < _heapSize) ? (_heapSize - _heapUsed) : 0;
+}
+
+//
+// Time
+//
+time_t host_time(time_t *tloc) {
+  time_t now = (time_t) (_nowMs / 1000);
+  if (tloc != NULL) {
+    *tloc = now;
+  }
+
+  return now;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  uint16_t ms = (uint16_t) (_nowMs % 1000);
+  host_time(tloc);
+  if (out_ms != NULL) {
+    *out_ms = ms;
+  }
+
+  return ms;
+}
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%llu] %s:%d ", (unsigned long long) _nowMs, src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
+
+//
+// Geometry and trigonometry
+//
+bool gpoint_equal(const GPoint * const point_a, const GPoint * const point_b) {
+  return point_a->x == point_b->x && point_a->y == point_b->y;
+}
+
+bool grect_equal(const GRect * const rect_a, const GRect * const rect_b) {
+  return gpoint_equal(&rect_a->origin, &rect_b->origin) &&
+         rect_a->size.w == rect_b->size.w && rect_a->size.h == rect_b->size.h;
+}
+
+bool grect_is_empty(const GRect * const rect) {
+  return rect->size.w <= 0 || rect->size.h <= 0;
+}
+
+GPoint grect_center_point(const GRect *rect) {
+  return GPoint(rect->origin.x + rect->size.w / 2, rect->origin.y + rect->size.h / 2);
+}
+
+bool grect_contains_point(const GRect *rect, const GPoint *point) {
+  return point->x >= rect->origin.x && point->x < rect->origin.x + rect->size.w &&
+         point->y >= rect->origin.y && point->y < rect->origin.y + rect->size.h;
+}
+
+void grect_clip(GRect * const rect_to_clip, const GRect * const rect_clipper) {
+  int16_t left = (rect_to_clip->origin.x > rect_clipper->origin.x) ? rect_to_clip->origin.x : rect_clipper->origin.x;
+  int16_t top = (rect_to_clip->origin.y > rect_clipper->origin.y) ? rect_to_clip->origin.y : rect_clipper->origin.y;
+  int16_t right = rect_to_clip->origin.x + rect_to_clip->size.w;
+  int16_t bottom = rect_to_clip->origin.y + rect_to_clip->size.h;
+  int16_t clipRight = rect_clipper->origin.x + rect_clipper->size.w;
+  int16_t clipBottom = rect_clipper->origin.y + rect_clipper->size.h;
+
+  if (right > clipRight) {
+    right = clipRight;
+  }
+
+  if (bottom > clipBottom) {
+    bottom = clipBottom;
+  }
+
+  *rect_to_clip = GRect(left, top, (right > left) ? right - left : 0, (bottom > top) ? bottom - top : 0);
+}
+
+int32_t sin_lookup(int32_t angle) {
+  return (int32_t) lround(sin(2.0 * M_PI * (double) angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return (int32_t) lround(cos(2.0 * M_PI * (double) angle / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+  double angle = atan2((double) y, (double) x);
+  if (angle < 0) {
+    angle += 2.0 * M_PI;
+  }
+
+  return (int32_t) (angle * TRIG_MAX_ANGLE / (2.0 * M_PI));
+}
+
+static int32_t integerSqrt(int32_t value) {
+  int32_t root = (int32_t) sqrt((double) value);
+  while (root * root > value) {
+    root--;
+  }
+
+  return root;
+}
+
+//
+// Bitmaps
+//
+static bool bitmapGetPixel(const GBitmap *bitmap, int16_t x, int16_t y) {
+  const uint8_t *row = (const uint8_t*) bitmap->addr + y * bitmap->row_size_bytes;
+  return (row[x >> 3] >> (x & 7)) & 1;
+}
+
+static GBitmap *bitmapCreate(GSize size) {
+  uint16_t rowSize = ((size.w + 31) / 32) * 4;
+  GBitmap *bitmap = host_malloc(sizeof(GBitmap));
+  if (bitmap == NULL) {
+    return NULL;
+  }
+
+  bitmap->addr = host_calloc(rowSize * size.h, 1);
+  bitmap->row_size_bytes = rowSize;
+  bitmap->info_flags = BITMAP_FLAG_OWNS_DATA;
+  bitmap->bounds = GRect(0, 0, size.w, size.h);
+  return bitmap;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  for (const HostResource *resource = g_host_resources; resource->data != NULL; resource++) {
+    if (resource->id == resource_id) {
+      GBitmap *bitmap = bitmapCreate(GSize(resource->width, resource->height));
+      if (bitmap != NULL) {
+        memcpy(bitmap->addr, resource->data, resource->row_size_bytes * resource->height);
+      }
+
+      return bitmap;
+    }
+  }
+
+  fprintf(stderr, "host: unknown bitmap resource %u\n", (unsigned) resource_id);
+  return NULL;
+}
+
+GBitmap *gbitmap_create_blank(GSize size) {
+  return bitmapCreate(size);
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect) {
+  GBitmap *bitmap = host_malloc(sizeof(GBitmap));
+  if (bitmap != NULL) {
+    *bitmap = *base_bitmap;
+    bitmap->info_flags = 0;
+    sub_rect.origin.x += base_bitmap->bounds.origin.x;
+    sub_rect.origin.y += base_bitmap->bounds.origin.y;
+    grect_clip(&sub_rect, &base_bitmap->bounds);
+    bitmap->bounds = sub_rect;
+  }
+
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (bitmap != NULL) {
+    if (bitmap->info_flags & BITMAP_FLAG_OWNS_DATA) {
+      host_free(bitmap->addr);
+    }
+
+    host_free(bitmap);
+  }
+}
+
+//
+// Graphics
+//
+GFont fonts_get_system_font(const char *font_key) {
+  for (size_t index = 0; index < sizeof(_fonts) / sizeof(_fonts[0]); index++) {
+    if (strcmp(_fonts[index].key, font_key) == 0) {
+      return &_fonts[index];
+    }
+  }
+
+  return &_fonts[0];
+}
+
+static void contextWritePixel(GContext *ctx, int16_t x, int16_t y, bool white) {
+  uint8_t *byte = (uint8_t*) ctx->dest->addr + y * ctx->dest->row_size_bytes + (x >> 3);
+  if (white) {
+    *byte |= (uint8_t) (1 << (x & 7));
+  } else {
+    *byte &= (uint8_t) ~(1 << (x & 7));
+  }
+
+  _stats.pixels_written++;
+}
+
+// Plots a pixel given in drawing coordinates.
+static void contextPlot(GContext *ctx, int16_t x, int16_t y, GColor color) {
+  if (color == GColorClear || ctx->frame_buffer_captured) {
+    return;
+  }
+
+  GPoint point = GPoint(x + ctx->offset.x, y + ctx->offset.y);
+  if (grect_contains_point(&ctx->clip, &point)) {
+    contextWritePixel(ctx, point.x, point.y, (color == GColorWhite));
+  }
+}
+
+static void contextHorizontalSpan(GContext *ctx, int16_t y, int16_t x0, int16_t x1, GColor color) {
+  if (x0 > x1) {
+    int16_t swap = x0;
+    x0 = x1;
+    x1 = swap;
+  }
+
+  for (int16_t x = x0; x <= x1; x++) {
+    contextPlot(ctx, x, y, color);
+  }
+}
+
+// Composites one source pixel onto a destination pixel given in screen coordinates.
+static void contextComposite(GContext *ctx, int16_t x, int16_t y, bool source, GCompOp mode) {
+  GPoint point = GPoint(x, y);
+  if (!grect_contains_point(&ctx->clip, &point)) {
+    return;
+  }
+
+  switch (mode) {
+    case GCompOpAssign:
+      contextWritePixel(ctx, x, y, source);
+      break;
+
+    case GCompOpAssignInverted:
+      contextWritePixel(ctx, x, y, !source);
+      break;
+
+    case GCompOpOr:
+      if (source) {
+        contextWritePixel(ctx, x, y, true);
+      }
+      break;
+
+    case GCompOpAnd:
+      if (!source) {
+        contextWritePixel(ctx, x, y, false);
+      }
+      break;
+
+    case GCompOpClear:
+      if (source) {
+        contextWritePixel(ctx, x, y, false);
+      }
+      break;
+
+    case GCompOpSet:
+      if (!source) {
+        contextWritePixel(ctx, x, y, true);
+      }
+      break;
+  }
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color) {
+  ctx->text_color = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->compositing_mode = mode;
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  _stats.draw_pixel++;
+  contextPlot(ctx, point.x, point.y, ctx->stroke_color);
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  _stats.draw_line++;
+
+  if (p0.y == p1.y) {
+    contextHorizontalSpan(ctx, p0.y, p0.x, p1.x, ctx->stroke_color);
+    return;
+  }
+
+  int dx = abs(p1.x - p0.x);
+  int dy = -abs(p1.y - p0.y);
+  int sx = (p0.x < p1.x) ? 1 : -1;
+  int sy = (p0.y < p1.y) ? 1 : -1;
+  int error = dx + dy;
+  int x = p0.x;
+  int y = p0.y;
+
+  while (true) {
+    contextPlot(ctx, x, y, ctx->stroke_color);
+    if (x == p1.x && y == p1.y) {
+      break;
+    }
+
+    int error2 = error * 2;
+    if (error2 >= dy) {
+      error += dy;
+      x += sx;
+    }
+
+    if (error2 <= dx) {
+      error += dx;
+      y += sy;
+    }
+  }
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect) {
+  _stats.draw_rect++;
+  if (grect_is_empty(&rect)) {
+    return;
+  }
+
+  int16_t right = rect.origin.x + rect.size.w - 1;
+  int16_t bottom = rect.origin.y + rect.size.h - 1;
+  contextHorizontalSpan(ctx, rect.origin.y, rect.origin.x, right, ctx->stroke_color);
+  contextHorizontalSpan(ctx, bottom, rect.origin.x, right, ctx->stroke_color);
+  for (int16_t y = rect.origin.y + 1; y < bottom; y++) {
+    contextPlot(ctx, rect.origin.x, y, ctx->stroke_color);
+    contextPlot(ctx, right, y, ctx->stroke_color);
+  }
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask) {
+  _stats.draw_rect++;
+  for (int16_t y = rect.origin.y; y < rect.origin.y + rect.size.h; y++) {
+    contextHorizontalSpan(ctx, y, rect.origin.x, rect.origin.x + rect.size.w - 1, ctx->fill_color);
+  }
+}
+
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  _stats.draw_circle++;
+  int x = radius;
+  int y = 0;
+  int error = 1 - x;
+
+  while (x >= y) {
+    contextPlot(ctx, p.x + x, p.y + y, ctx->stroke_color);
+    contextPlot(ctx, p.x + y, p.y + x, ctx->stroke_color);
+    contextPlot(ctx, p.x - y, p.y + x, ctx->stroke_color);
+    contextPlot(ctx, p.x - x, p.y + y, ctx->stroke_color);
+    contextPlot(ctx, p.x - x, p.y - y, ctx->stroke_color);
+    contextPlot(ctx, p.x - y, p.y - x, ctx->stroke_color);
+    contextPlot(ctx, p.x + y, p.y - x, ctx->stroke_color);
+    contextPlot(ctx, p.x + x, p.y - y, ctx->stroke_color);
+    y++;
+    if (error < 0) {
+      error += 2 * y + 1;
+    } else {
+      x--;
+      error += 2 * (y - x) + 1;
+    }
+  }
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  _stats.draw_circle++;
+  int32_t radiusSquared = radius * radius + radius;
+  for (int16_t dy = -radius; dy <= radius; dy++) {
+    int16_t dx = (int16_t) integerSqrt(radiusSquared - dy * dy);
+    contextHorizontalSpan(ctx, p.y + dy, p.x - dx, p.x + dx, ctx->fill_color);
+  }
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  _stats.draw_bitmap++;
+  if (bitmap == NULL || ctx->frame_buffer_captured || grect_is_empty(&bitmap->bounds)) {
+    return;
+  }
+
+  // Bitmaps tile to fill the rect, like the firmware.
+  for (int16_t dy = 0; dy < rect.size.h; dy++) {
+    int16_t sourceY = bitmap->bounds.origin.y + (dy % bitmap->bounds.size.h);
+    for (int16_t dx = 0; dx < rect.size.w; dx++) {
+      int16_t sourceX = bitmap->bounds.origin.x + (dx % bitmap->bounds.size.w);
+      contextComposite(ctx, rect.origin.x + dx + ctx->offset.x, rect.origin.y + dy + ctx->offset.y,
+                       bitmapGetPixel(bitmap, sourceX, sourceY), ctx->compositing_mode);
+    }
+  }
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont const font, const GRect box,
+                        const GTextOverflowMode overflow_mode, const GTextAlignment alignment, const void *layout) {
+  // Glyphs are not rasterized on the host. Only the call is counted.
+  _stats.draw_text++;
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  if (ctx->frame_buffer_captured) {
+    return NULL;
+  }
+
+  _stats.frame_buffer_captures++;
+  ctx->frame_buffer_captured = true;
+  return ctx->dest;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  if (!ctx->frame_buffer_captured || buffer != ctx->dest) {
+    return false;
+  }
+
+  ctx->frame_buffer_captured = false;
+  return true;
+}
+
+bool graphics_frame_buffer_is_captured(GContext *ctx) {
+  return ctx->frame_buffer_captured;
+}
+
+//
+// Layers
+//
+static void requestRender(void) {
+  if (!_rendering) {
+    _needsRender = true;
+  }
+}
+
+static void layerInit(Layer *layer, GRect frame, LayerKind kind) {
+  memset(layer, 0, sizeof(Layer));
+  layer->frame = frame;
+  layer->bounds = GRect(0, 0, frame.size.w, frame.size.h);
+  layer->clips = true;
+  layer->kind = kind;
+}
+
+Layer *layer_create(GRect frame) {
+  return layer_create_with_data(frame, 0);
+}
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = host_malloc(sizeof(Layer) + data_size);
+  if (layer != NULL) {
+    layerInit(layer, frame, LAYER_PLAIN);
+    layer->data_size = data_size;
+    memset(layer + 1, 0, data_size);
+  }
+
+  return layer;
+}
+
+void *layer_get_data(const Layer *layer) {
+  return (layer->data_size > 0) ? (void*) (layer + 1) : NULL;
+}
+
+static void layerDeinit(Layer *layer) {
+  layer_remove_from_parent(layer);
+  layer_remove_child_layers(layer);
+}
+
+void layer_destroy(Layer *layer) {
+  if (layer != NULL) {
+    layerDeinit(layer);
+    host_free(layer);
+  }
+}
+
+void layer_mark_dirty(Layer *layer) {
+  requestRender();
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  // Like the firmware, bounds follow the frame size when they matched it before.
+  if (layer->bounds.origin.x == 0 && layer->bounds.origin.y == 0 &&
+      layer->bounds.size.w == layer->frame.size.w && layer->bounds.size.h == layer->frame.size.h) {
+    layer->bounds.size = frame.size;
+  }
+
+  layer->frame = frame;
+  requestRender();
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+  layer->bounds = bounds;
+  requestRender();
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return layer->bounds;
+}
+
+void layer_remove_from_parent(Layer *child) {
+  Layer *parent = child->parent;
+  if (parent == NULL) {
+    return;
+  }
+
+  Layer **link = &parent->first_child;
+  while (*link != NULL && *link != child) {
+    link = &(*link)->next_sibling;
+  }
+
+  if (*link == child) {
+    *link = child->next_sibling;
+  }
+
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  requestRender();
+}
+
+void layer_remove_child_layers(Layer *parent) {
+  while (parent->first_child != NULL) {
+    layer_remove_from_parent(parent->first_child);
+  }
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  layer_remove_from_parent(child);
+  Layer **link = &parent->first_child;
+  while (*link != NULL) {
+    link = &(*link)->next_sibling;
+  }
+
+  *link = child;
+  child->parent = parent;
+  requestRender();
+}
+
+void layer_insert_below_sibling(Layer *layer_to_insert, Layer *below_sibling_layer) {
+  Layer *parent = below_sibling_layer->parent;
+  if (parent == NULL) {
+    return;
+  }
+
+  layer_remove_from_parent(layer_to_insert);
+  Layer **link = &parent->first_child;
+  while (*link != below_sibling_layer) {
+    link = &(*link)->next_sibling;
+  }
+
+  layer_to_insert->next_sibling = below_sibling_layer;
+  layer_to_insert->parent = parent;
+  *link = layer_to_insert;
+  requestRender();
+}
+
+void layer_insert_above_sibling(Layer *layer_to_insert, Layer *above_sibling_layer) {
+  Layer *parent = above_sibling_layer->parent;
+  if (parent == NULL) {
+    return;
+  }
+
+  layer_remove_from_parent(layer_to_insert);
+  layer_to_insert->next_sibling = above_sibling_layer->next_sibling;
+  layer_to_insert->parent = parent;
+  above_sibling_layer->next_sibling = layer_to_insert;
+  requestRender();
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if (layer->hidden != hidden) {
+    layer->hidden = hidden;
+    requestRender();
+  }
+}
+
+bool layer_get_hidden(const Layer *layer) {
+  return layer->hidden;
+}
+
+void layer_set_clips(Layer *layer, bool clips) {
+  layer->clips = clips;
+  requestRender();
+}
+
+static GRect alignRect(GRect bounds, GSize size, GAlign alignment) {
+  GRect rect = { bounds.origin, size };
+  switch (alignment) {
+    case GAlignTopLeft:
+      break;
+
+    case GAlignTop:
+      rect.origin.x += (bounds.size.w - size.w) / 2;
+      break;
+
+    case GAlignTopRight:
+      rect.origin.x += bounds.size.w - size.w;
+      break;
+
+    case GAlignLeft:
+      rect.origin.y += (bounds.size.h - size.h) / 2;
+      break;
+
+    case GAlignRight:
+      rect.origin.x += bounds.size.w - size.w;
+      rect.origin.y += (bounds.size.h - size.h) / 2;
+      break;
+
+    case GAlignBottomLeft:
+      rect.origin.y += bounds.size.h - size.h;
+      break;
+
+    case GAlignBottom:
+      rect.origin.x += (bounds.size.w - size.w) / 2;
+      rect.origin.y += bounds.size.h - size.h;
+      break;
+
+    case GAlignBottomRight:
+      rect.origin.x += bounds.size.w - size.w;
+      rect.origin.y += bounds.size.h - size.h;
+      break;
+
+    default:
+      rect.origin.x += (bounds.size.w - size.w) / 2;
+      rect.origin.y += (bounds.size.h - size.h) / 2;
+      break;
+  }
+
+  return rect;
+}
+
+static void bitmapLayerUpdateProc(Layer *layer, GContext *ctx) {
+  BitmapLayer *bitmapLayer = (BitmapLayer*) layer;
+  if (bitmapLayer->background_color != GColorClear) {
+    graphics_context_set_fill_color(ctx, bitmapLayer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+
+  if (bitmapLayer->bitmap != NULL) {
+    graphics_context_set_compositing_mode(ctx, bitmapLayer->compositing_mode);
+    graphics_draw_bitmap_in_rect(ctx, bitmapLayer->bitmap,
+                                 alignRect(layer->bounds, bitmapLayer->bitmap->bounds.size, bitmapLayer->alignment));
+  }
+}
+
+BitmapLayer *bitmap_layer_create(GRect frame) {
+  BitmapLayer *bitmapLayer = host_calloc(1, sizeof(BitmapLayer));
+  if (bitmapLayer != NULL) {
+    layerInit(&bitmapLayer->layer, frame, LAYER_BITMAP);
+    bitmapLayer->layer.update_proc = bitmapLayerUpdateProc;
+    bitmapLayer->background_color = GColorClear;
+    bitmapLayer->compositing_mode = GCompOpAssign;
+    bitmapLayer->alignment = GAlignCenter;
+  }
+
+  return bitmapLayer;
+}
+
+void bitmap_layer_destroy(BitmapLayer *bitmap_layer) {
+  if (bitmap_layer != NULL) {
+    layerDeinit(&bitmap_layer->layer);
+    host_free(bitmap_layer);
+  }
+}
+
+Layer *bitmap_layer_get_layer(const BitmapLayer *bitmap_layer) {
+  return (Layer*) &bitmap_layer->layer;
+}
+
+void bitmap_layer_set_bitmap(BitmapLayer *bitmap_layer, const GBitmap *bitmap) {
+  bitmap_layer->bitmap = bitmap;
+  requestRender();
+}
+
+void bitmap_layer_set_alignment(BitmapLayer *bitmap_layer, GAlign alignment) {
+  bitmap_layer->alignment = alignment;
+  requestRender();
+}
+
+void bitmap_layer_set_background_color(BitmapLayer *bitmap_layer, GColor color) {
+  bitmap_layer->background_color = color;
+  requestRender();
+}
+
+void bitmap_layer_set_compositing_mode(BitmapLayer *bitmap_layer, GCompOp mode) {
+  bitmap_layer->compositing_mode = mode;
+  requestRender();
+}
+
+static void rotBitmapLayerUpdateProc(Layer *layer, GContext *ctx) {
+  RotBitmapLayer *rotLayer = (RotBitmapLayer*) layer;
+  const GBitmap *bitmap = rotLayer->bitmap;
+  if (bitmap == NULL || ctx->frame_buffer_captured) {
+    return;
+  }
+
+  _stats.draw_bitmap++;
+  int32_t cosine = cos_lookup(rotLayer->rotation);
+  int32_t sine = sin_lookup(rotLayer->rotation);
+
+  // Map every destination pixel back into the source bitmap.
+  for (int16_t y = 0; y < layer->bounds.size.h; y++) {
+    int32_t relY = y - rotLayer->dest_ic.y;
+    for (int16_t x = 0; x < layer->bounds.size.w; x++) {
+      int32_t relX = x - rotLayer->dest_ic.x;
+      int32_t sourceX = rotLayer->src_ic.x;
+      int32_t sourceY = rotLayer->src_ic.y;
+      if (rotLayer->rotation == 0) {
+        sourceX += relX;
+        sourceY += relY;
+      } else {
+        sourceX += (relX * cosine + relY * sine) / TRIG_MAX_RATIO;
+        sourceY += (relY * cosine - relX * sine) / TRIG_MAX_RATIO;
+      }
+
+      GPoint screen = GPoint(x + ctx->offset.x, y + ctx->offset.y);
+      if (sourceX >= 0 && sourceX < bitmap->bounds.size.w && sourceY >= 0 && sourceY < bitmap->bounds.size.h) {
+        contextComposite(ctx, screen.x, screen.y,
+                         bitmapGetPixel(bitmap, bitmap->bounds.origin.x + sourceX, bitmap->bounds.origin.y + sourceY),
+                         rotLayer->compositing_mode);
+
+      } else if (rotLayer->corner_clip_color != GColorClear) {
+        contextComposite(ctx, screen.x, screen.y, (rotLayer->corner_clip_color == GColorWhite), GCompOpAssign);
+      }
+    }
+  }
+}
+
+RotBitmapLayer *rot_bitmap_layer_create(GBitmap *bitmap) {
+  RotBitmapLayer *rotLayer = host_calloc(1, sizeof(RotBitmapLayer));
+  if (rotLayer != NULL) {
+    int32_t w = bitmap->bounds.size.w;
+    int32_t h = bitmap->bounds.size.h;
+    int16_t hypotenuse = (int16_t) integerSqrt(w * w + h * h);
+
+    layerInit(&rotLayer->layer, GRect(0, 0, hypotenuse, hypotenuse), LAYER_ROT_BITMAP);
+    rotLayer->layer.update_proc = rotBitmapLayerUpdateProc;
+    rotLayer->bitmap = bitmap;
+    rotLayer->corner_clip_color = GColorClear;
+    rotLayer->compositing_mode = GCompOpAssign;
+    rotLayer->src_ic = GPoint(w / 2, h / 2);
+    rotLayer->dest_ic = GPoint(hypotenuse / 2, hypotenuse / 2);
+  }
+
+  return rotLayer;
+}
+
+void rot_bitmap_layer_destroy(RotBitmapLayer *bitmap) {
+  if (bitmap != NULL) {
+    layerDeinit(&bitmap->layer);
+    host_free(bitmap);
+  }
+}
+
+void rot_bitmap_layer_set_corner_clip_color(RotBitmapLayer *bitmap, GColor color) {
+  bitmap->corner_clip_color = color;
+  requestRender();
+}
+
+void rot_bitmap_layer_set_angle(RotBitmapLayer *bitmap, int32_t angle) {
+  bitmap->rotation = angle % TRIG_MAX_ANGLE;
+  requestRender();
+}
+
+void rot_bitmap_layer_increment_angle(RotBitmapLayer *bitmap, int32_t angle_change) {
+  rot_bitmap_layer_set_angle(bitmap, bitmap->rotation + angle_change);
+}
+
+void rot_bitmap_set_src_ic(RotBitmapLayer *bitmap, GPoint ic) {
+  // Grow the frame so the bitmap stays fully visible at any angle around the new center.
+  int32_t horizontal = (ic.x > abs(bitmap->bitmap->bounds.size.w - ic.x)) ? ic.x : abs(bitmap->bitmap->bounds.size.w - ic.x);
+  int32_t vertical = (ic.y > abs(bitmap->bitmap->bounds.size.h - ic.y)) ? ic.y : abs(bitmap->bitmap->bounds.size.h - ic.y);
+  int16_t size = (int16_t) (integerSqrt(horizontal * horizontal + vertical * vertical) * 2);
+
+  bitmap->src_ic = ic;
+  GRect frame = bitmap->layer.frame;
+  frame.size = GSize(size, size);
+  bitmap->layer.frame = frame;
+  bitmap->layer.bounds = GRect(0, 0, size, size);
+  bitmap->dest_ic = GPoint(size / 2, size / 2);
+  requestRender();
+}
+
+void rot_bitmap_set_compositing_mode(RotBitmapLayer *bitmap, GCompOp mode) {
+  bitmap->compositing_mode = mode;
+  requestRender();
+}
+
+static void textLayerUpdateProc(Layer *layer, GContext *ctx) {
+  TextLayer *textLayer = (TextLayer*) layer;
+  if (textLayer->background_color != GColorClear) {
+    graphics_context_set_fill_color(ctx, textLayer->background_color);
+    graphics_fill_rect(ctx, layer->bounds, 0, GCornerNone);
+  }
+
+  if (textLayer->text != NULL) {
+    graphics_context_set_text_color(ctx, textLayer->text_color);
+    graphics_draw_text(ctx, textLayer->text, textLayer->font, layer->bounds,
+                       textLayer->overflow_mode, textLayer->alignment, NULL);
+  }
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *textLayer = host_calloc(1, sizeof(TextLayer));
+  if (textLayer != NULL) {
+    layerInit(&textLayer->layer, frame, LAYER_TEXT);
+    textLayer->layer.update_proc = textLayerUpdateProc;
+    textLayer->font = fonts_get_system_font(FONT_KEY_GOTHIC_14_BOLD);
+    textLayer->text_color = GColorBlack;
+    textLayer->background_color = GColorWhite;
+    textLayer->alignment = GTextAlignmentLeft;
+    textLayer->overflow_mode = GTextOverflowModeWordWrap;
+  }
+
+  return textLayer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  if (text_layer != NULL) {
+    layerDeinit(&text_layer->layer);
+    host_free(text_layer);
+  }
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  text_layer->text = text;
+  requestRender();
+}
+
+const char *text_layer_get_text(TextLayer *text_layer) {
+  return text_layer->text;
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {
+  text_layer->background_color = color;
+  requestRender();
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {
+  text_layer->text_color = color;
+  requestRender();
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {
+  text_layer->font = font;
+  requestRender();
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {
+  text_layer->alignment = text_alignment;
+  requestRender();
+}
+
+void text_layer_set_overflow_mode(TextLayer *text_layer, GTextOverflowMode line_mode) {
+  text_layer->overflow_mode = line_mode;
+  requestRender();
+}
+
+//
+// Window
+//
+Window *window_create(void) {
+  Window *window = host_calloc(1, sizeof(Window));
+  if (window != NULL) {
+    window->root_layer = layer_create(GRect(0, 0, HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT));
+    window->background_color = GColorWhite;
+  }
+
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (window != NULL) {
+    if (window->on_stack) {
+      window_stack_pop(false);
+    }
+
+    if (window->loaded && window->handlers.unload != NULL) {
+      window->handlers.unload(window);
+    }
+
+    layer_destroy(window->root_layer);
+    host_free(window);
+  }
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return window->root_layer;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  window->background_color = background_color;
+  requestRender();
+}
+
+void window_stack_push(Window *window, bool animated) {
+  _topWindow = window;
+  window->on_stack = true;
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load != NULL) {
+      window->handlers.load(window);
+    }
+  }
+
+  if (window->handlers.appear != NULL) {
+    window->handlers.appear(window);
+  }
+
+  requestRender();
+}
+
+Window *window_stack_pop(bool animated) {
+  Window *window = _topWindow;
+  if (window != NULL) {
+    if (window->handlers.disappear != NULL) {
+      window->handlers.disappear(window);
+    }
+
+    window->on_stack = false;
+    _topWindow = NULL;
+  }
+
+  return window;
+}
+
+//
+// Rendering
+//
+static void renderLayer(Layer *layer, GContext *ctx, GPoint parentOrigin, GRect parentClip) {
+  if (layer->hidden) {
+    return;
+  }
+
+  GPoint frameOrigin = GPoint(parentOrigin.x + layer->frame.origin.x, parentOrigin.y + layer->frame.origin.y);
+  GRect clip = parentClip;
+  if (layer->clips) {
+    GRect frameRect = { frameOrigin, layer->frame.size };
+    grect_clip(&clip, &frameRect);
+  }
+
+  GPoint boundsOrigin = GPoint(frameOrigin.x + layer->bounds.origin.x, frameOrigin.y + layer->bounds.origin.y);
+  if (layer->update_proc != NULL && !grect_is_empty(&clip)) {
+    ctx->offset = boundsOrigin;
+    ctx->clip = clip;
+    ctx->stroke_color = GColorBlack;
+    ctx->fill_color = GColorBlack;
+    ctx->text_color = GColorBlack;
+    ctx->compositing_mode = GCompOpAssign;
+
+    uint64_t start = cpuNanos();
+    layer->update_proc(layer, ctx);
+    profileRecord((const void*) layer->update_proc, "update", cpuNanos() - start);
+    _stats.update_procs++;
+
+    if (ctx->frame_buffer_captured) {
+      fprintf(stderr, "host: update proc %p did not release the frame buffer\n", (void*) layer->update_proc);
+      ctx->frame_buffer_captured = false;
+    }
+  }
+
+  for (Layer *child = layer->first_child; child != NULL; child = child->next_sibling) {
+    renderLayer(child, ctx, boundsOrigin, clip);
+  }
+}
+
+static uint32_t framebufferHash(void) {
+  uint32_t hash = 2166136261u;
+  for (size_t index = 0; index < sizeof(_framebufferData); index++) {
+    hash = (hash ^ _framebufferData[index]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static void writeFrame(uint32_t frameIndex) {
+  char path[512];
+  snprintf(path, sizeof(path), "%s/frame_%05u.pbm", _framesDir, (unsigned) frameIndex);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    fprintf(stderr, "host: unable to write %s\n", path);
+    return;
+  }
+
+  // PBM rows are MSB first and 1 is black.
+  fprintf(file, "P4\n%d %d\n", HOST_SCREEN_WIDTH, HOST_SCREEN_HEIGHT);
+  for (int y = 0; y < HOST_SCREEN_HEIGHT; y++) {
+    for (int byteIndex = 0; byteIndex < HOST_SCREEN_WIDTH / 8; byteIndex++) {
+      uint8_t source = _framebufferData[y * HOST_FRAMEBUFFER_ROW_SIZE + byteIndex];
+      uint8_t packed = 0;
+      for (int bit = 0; bit < 8; bit++) {
+        if (((source >> bit) & 1) == 0) {
+          packed |= (uint8_t) (0x80 >> bit);
+        }
+      }
+      fputc(packed, file);
+    }
+  }
+
+  fclose(file);
+}
+
+static void render(void) {
+  _needsRender = false;
+  if (_topWindow == NULL) {
+    return;
+  }
+
+  _rendering = true;
+  uint64_t start = cpuNanos();
+
+  memset(_framebufferData, (_topWindow->background_color == GColorWhite) ? 0xff : 0x00, sizeof(_framebufferData));
+  GContext ctx;
+  memset(&ctx, 0, sizeof(ctx));
+  ctx.dest = &_framebuffer;
+  renderLayer(_topWindow->root_layer, &ctx, GPointZero, _framebuffer.bounds);
+
+  _stats.render_ns += cpuNanos() - start;
+  _stats.frames++;
+  _rendering = false;
+
+  if (_trace) {
+    printf("frame %u t=%llu hash=%08x\n", (unsigned) _stats.frames,
+           (unsigned long long) (_nowMs - _startMs),
+           (unsigned) framebufferHash());
+  }
+
+  if (_framesDir != NULL) {
+    writeFrame(_stats.frames);
+  }
+}
+
+//
+// Timers and animation
+//
+// Keeps the list ordered by fire time, then registration order.
+static void timerInsert(AppTimer *timer) {
+  AppTimer **link = &_timers;
+  while (*link != NULL && (*link)->fire_ms <= timer->fire_ms) {
+    link = &(*link)->next;
+  }
+
+  timer->next = *link;
+  *link = timer;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  AppTimer *timer = malloc(sizeof(AppTimer));
+  timer->fire_ms = _nowMs + timeout_ms + _timerDelayMs;
+  timer->sequence = _timerSequence++;
+  timer->callback = callback;
+  timer->callback_data = callback_data;
+  timerInsert(timer);
+  return timer;
+}
+
+static bool timerUnlink(AppTimer *timer_handle) {
+  for (AppTimer **link = &_timers; *link != NULL; link = &(*link)->next) {
+    if (*link == timer_handle) {
+      *link = timer_handle->next;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  if (!timerUnlink(timer_handle)) {
+    return false;
+  }
+
+  timer_handle->fire_ms = _nowMs + new_timeout_ms + _timerDelayMs;
+  timer_handle->sequence = _timerSequence++;
+  timerInsert(timer_handle);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  if (timerUnlink(timer_handle)) {
+    free(timer_handle);
+  }
+}
+
+bool animation_is_scheduled(Animation *animation) {
+  return false;
+}
+
+void animation_unschedule(Animation *animation) {
+}
+
+void animation_unschedule_all(void) {
+}
+
+void property_animation_destroy(PropertyAnimation *property_animation) {
+}
+
+//
+// Event services
+//
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  _tickUnits = tick_units;
+  _tickHandler = handler;
+}
+
+void tick_timer_service_unsubscribe(void) {
+  _tickUnits = 0;
+  _tickHandler = NULL;
+}
+
+void bluetooth_connection_service_subscribe(BluetoothConnectionHandler handler) {
+  _bluetoothHandler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void) {
+  _bluetoothHandler = NULL;
+}
+
+bool bluetooth_connection_service_peek(void) {
+  return _bluetoothConnected;
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  _tapHandler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  _tapHandler = NULL;
+}
+
+void app_focus_service_subscribe(AppFocusHandler handler) {
+  _focusHandler = handler;
+}
+
+void app_focus_service_unsubscribe(void) {
+  _focusHandler = NULL;
+}
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  _batteryHandler = handler;
+}
+
+void battery_state_service_unsubscribe(void) {
+  _batteryHandler = NULL;
+}
+
+BatteryChargeState battery_state_service_peek(void) {
+  bool charging = envInt("WIPER_HOST_CHARGING", 0) != 0;
+  return (BatteryChargeState) { (uint8_t) envInt("WIPER_HOST_BATTERY", 80), charging, charging };
+}
+
+bool clock_is_24h_style(void) {
+  return envInt("WIPER_HOST_24H", 0) != 0;
+}
+
+void vibes_short_pulse(void) {
+}
+
+//
+// Persistent storage
+//
+static int persistFind(const uint32_t key) {
+  for (int index = 0; index < _persistCount; index++) {
+    if (_persistKeys[index] == key) {
+      return index;
+    }
+  }
+
+  return -1;
+}
+
+bool persist_exists(const uint32_t key) {
+  return persistFind(key) >= 0;
+}
+
+int32_t persist_read_int(const uint32_t key) {
+  int index = persistFind(key);
+  return (index >= 0) ? _persistValues[index] : 0;
+}
+
+int persist_write_int(const uint32_t key, const int32_t value) {
+  int index = persistFind(key);
+  if (index < 0) {
+    if (_persistCount == HOST_MAX_PERSIST_KEYS) {
+      return -1;
+    }
+
+    index = _persistCount++;
+    _persistKeys[index] = key;
+  }
+
+  _persistValues[index] = value;
+  return sizeof(int32_t);
+}
+
+int persist_delete(const uint32_t key) {
+  int index = persistFind(key);
+  if (index >= 0) {
+    _persistCount--;
+    _persistKeys[index] = _persistKeys[_persistCount];
+    _persistValues[index] = _persistValues[_persistCount];
+  }
+
+  return 0;
+}
+
+//
+// AppMessage. The phone is never connected on the host, so nothing arrives
+// and nothing is sent.
+//
+Tuple *dict_read_first(DictionaryIterator *iter) {
+  return NULL;
+}
+
+Tuple *dict_read_next(DictionaryIterator *iter) {
+  return NULL;
+}
+
+DictionaryResult dict_write_tuplet(DictionaryIterator *iter, const Tuplet * const tuplet) {
+  return DICT_INVALID_ARGS;
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+  return 0;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  return APP_MSG_OK;
+}
+
+uint32_t app_message_inbox_size_maximum(void) {
+  return 124;
+}
+
+uint32_t app_message_outbox_size_maximum(void) {
+  return 636;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  *iterator = NULL;
+  return APP_MSG_BUSY;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  return APP_MSG_BUSY;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  return NULL;
+}
+
+AppMessageInboxDropped app_message_register_inbox_dropped(AppMessageInboxDropped dropped_callback) {
+  return NULL;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  return NULL;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+  return NULL;
+}
+
+//
+// Event loop
+//
+// Counted from the last tick rather than now, so a timer due at the same
+// moment doesn't swallow the tick.
+static uint64_t nextTickMs(void) {
+  uint64_t unitMs = (_tickUnits & SECOND_UNIT) ? 1000 : 60000;
+  return ((_lastTickMs / unitMs) + 1) * unitMs;
+}
+
+static void dispatchTick(void) {
+  time_t previous = (time_t) ((_nowMs - 1) / 1000);
+  time_t now = (time_t) (_nowMs / 1000);
+  struct tm before = *localtime(&previous);
+  struct tm *tickTime = localtime(&now);
+
+  TimeUnits changed = SECOND_UNIT;
+  if (tickTime->tm_min != before.tm_min) changed |= MINUTE_UNIT;
+  if (tickTime->tm_hour != before.tm_hour) changed |= HOUR_UNIT;
+  if (tickTime->tm_yday != before.tm_yday) changed |= DAY_UNIT;
+  if (tickTime->tm_mon != before.tm_mon) changed |= MONTH_UNIT;
+  if (tickTime->tm_year != before.tm_year) changed |= YEAR_UNIT;
+
+  _lastTickMs = _nowMs;
+  _stats.ticks++;
+  uint64_t start = cpuNanos();
+  _tickHandler(tickTime, changed);
+  uint64_t elapsed = cpuNanos() - start;
+  profileRecord((const void*) _tickHandler, "tick", elapsed);
+  _stats.callback_ns += elapsed;
+}
+
+static void dispatchTimer(void) {
+  AppTimer *timer = _timers;
+  _timers = timer->next;
+  AppTimerCallback callback = timer->callback;
+  void *callbackData = timer->callback_data;
+  free(timer);
+
+  _stats.timer_fires++;
+  uint64_t start = cpuNanos();
+  callback(callbackData);
+  uint64_t elapsed = cpuNanos() - start;
+  profileRecord((const void*) callback, "timer", elapsed);
+  _stats.callback_ns += elapsed;
+}
+
+// Static functions have no dynamic symbol, so fall back to addr2line on our own
+// binary and finally to the raw offset.
+static void resolveFunctionName(const void *fn, char *name, size_t size) {
+  Dl_info info;
+  if (dladdr(fn, &info) == 0) {
+    snprintf(name, size, "%p", fn);
+    return;
+  }
+
+  if (info.dli_sname != NULL && info.dli_saddr == fn) {
+    snprintf(name, size, "%s", info.dli_sname);
+    return;
+  }
+
+  unsigned long offset = (unsigned long) ((const char*) fn - (const char*) info.dli_fbase);
+  snprintf(name, size, "0x%lx", offset);
+
+  char command[128];
+  snprintf(command, sizeof(command), "addr2line -f -e /proc/%d/exe 0x%lx 2>/dev/null", (int) getpid(), offset);
+  FILE *pipe = popen(command, "r");
+  if (pipe != NULL) {
+    char line[64];
+    if (fgets(line, sizeof(line), pipe) != NULL && line[0] != '?') {
+      line[strcspn(line, "\n")] = '\0';
+      snprintf(name, size, "%s", line);
+    }
+
+    pclose(pipe);
+  }
+}
+
+static void printReport(void) {
+  double seconds = (double) (_endMs - _startMs) / 1000.0;
+
+  fprintf(stderr, "\nhost: simulated %.0f s\n", seconds);
+  fprintf(stderr, "  frames            %u (%.2f per simulated second)\n", (unsigned) _stats.frames, _stats.frames / seconds);
+  fprintf(stderr, "  render cpu        %.3f ms (%.1f us per frame)\n", _stats.render_ns / 1e6,
+          _stats.frames ? _stats.render_ns / 1e3 / _stats.frames : 0.0);
+  fprintf(stderr, "  callback cpu      %.3f ms\n", _stats.callback_ns / 1e6);
+  fprintf(stderr, "  wakeups           %u timers, %u ticks\n", (unsigned) _stats.timer_fires, (unsigned) _stats.ticks);
+  fprintf(stderr, "  update procs      %u\n", (unsigned) _stats.update_procs);
+  fprintf(stderr, "  graphics calls    %u pixel, %u line, %u rect, %u circle, %u bitmap, %u text\n",
+          (unsigned) _stats.draw_pixel, (unsigned) _stats.draw_line, (unsigned) _stats.draw_rect,
+          (unsigned) _stats.draw_circle, (unsigned) _stats.draw_bitmap, (unsigned) _stats.draw_text);
+  fprintf(stderr, "  frame captures    %u\n", (unsigned) _stats.frame_buffer_captures);
+  fprintf(stderr, "  pixels written    %llu\n", (unsigned long long) _stats.pixels_written);
+  fprintf(stderr, "  heap              %u bytes in use, %u peak of %u, %u allocations\n",
+          (unsigned) _heapUsed, (unsigned) _heapPeak, (unsigned) _heapSize, (unsigned) _heapAllocations);
+
+  fprintf(stderr, "  %-7s %-38s %8s %12s %10s\n", "kind", "function", "calls", "total us", "us/call");
+  for (int index = 0; index < _profileCount; index++) {
+    char name[64];
+    resolveFunctionName(_profile[index].fn, name, sizeof(name));
+    fprintf(stderr, "  %-7s %-38s %8u %12.1f %10.2f\n", _profile[index].kind, name, (unsigned) _profile[index].calls,
+            _profile[index].ns / 1e3, _profile[index].ns / 1e3 / _profile[index].calls);
+  }
+}
+
+static void printLeaks(void) {
+  if (_heapUsed > 0) {
+    fprintf(stderr, "host: %u heap bytes still allocated at exit\n", (unsigned) _heapUsed);
+  }
+}
+
+__attribute__((constructor))
+static void hostInit(void) {
+  _startMs = (uint64_t) envInt("WIPER_HOST_START", HOST_DEFAULT_START) * 1000;
+  _nowMs = _startMs;
+  _lastTickMs = _startMs;
+  _endMs = _startMs + (uint64_t) envInt("WIPER_HOST_SECONDS", HOST_DEFAULT_SECONDS) * 1000;
+  _heapSize = (size_t) envInt("WIPER_HOST_HEAP", HOST_DEFAULT_HEAP);
+  _trace = envInt("WIPER_HOST_TRACE", 0) != 0;
+  _framesDir = getenv("WIPER_HOST_FRAMES");
+  _timerDelayMs = (uint32_t) envInt("WIPER_HOST_TIMER_DELAY", 0);
+  if (envInt("WIPER_HOST_DISCONNECT", -1) >= 0) {
+    _disconnectMs = _startMs + (uint64_t) envInt("WIPER_HOST_DISCONNECT", -1) * 1000;
+  }
+  if (envInt("WIPER_HOST_UNFOCUS", -1) >= 0) {
+    _unfocusMs = _startMs + (uint64_t) envInt("WIPER_HOST_UNFOCUS", -1) * 1000;
+  }
+  if (envInt("WIPER_HOST_FOCUS", -1) >= 0) {
+    _focusMs = _startMs + (uint64_t) envInt("WIPER_HOST_FOCUS", -1) * 1000;
+  }
+
+  // Taps have to be listed in order.
+  const char *taps = getenv("WIPER_HOST_TAPS");
+  while (taps != NULL && *taps != '\0' && _tapCount < HOST_MAX_TAPS) {
+    char *end;
+    _tapMs[_tapCount++] = _startMs + (uint64_t) strtol(taps, &end, 10) * 1000;
+    taps = (*end == ',') ? end + 1 : NULL;
+  }
+
+  const char *persist = getenv("WIPER_HOST_PERSIST");
+  while (persist != NULL && *persist != '\0') {
+    char *end;
+    uint32_t key = (uint32_t) strtoul(persist, &end, 10);
+    if (*end != '=') {
+      break;
+    }
+    persist_write_int(key, (int32_t) strtol(end + 1, &end, 10));
+    persist = (*end == ',') ? end + 1 : NULL;
+  }
+  atexit(printLeaks);
+}
+
+void app_event_loop(void) {
+  while (true) {
+    if (_needsRender) {
+      render();
+    }
+
+    uint64_t tickMs = (_tickHandler != NULL) ? nextTickMs() : UINT64_MAX;
+    uint64_t timerMs = (_timers != NULL) ? _timers->fire_ms : UINT64_MAX;
+    uint64_t nextMs = (timerMs <= tickMs) ? timerMs : tickMs;
+    if (_disconnectMs <= nextMs && _disconnectMs <= _endMs) {
+      _nowMs = _disconnectMs;
+      _disconnectMs = UINT64_MAX;
+      _bluetoothConnected = false;
+      if (_bluetoothHandler != NULL) {
+        _bluetoothHandler(false);
+      }
+      continue;
+    }
+    if (_unfocusMs <= nextMs && _unfocusMs <= _endMs) {
+      _nowMs = _unfocusMs;
+      _unfocusMs = UINT64_MAX;
+      if (_focusHandler != NULL) {
+        _focusHandler(false);
+      }
+      continue;
+    }
+    uint64_t tapMs = (_nextTap < _tapCount) ? _tapMs[_nextTap] : UINT64_MAX;
+    if (tapMs <= nextMs && tapMs <= _endMs) {
+      _nowMs = tapMs;
+      _nextTap++;
+      if (_tapHandler != NULL) {
+        _tapHandler(ACCEL_AXIS_Y, 1);
+      }
+      continue;
+    }
+    if (_focusMs <= nextMs && _focusMs <= _endMs) {
+      _nowMs = _focusMs;
+      _focusMs = UINT64_MAX;
+      if (_focusHandler != NULL) {
+        _focusHandler(true);
+      }
+      continue;
+    }
+
+    if (nextMs > _endMs) {
+      break;
+    }
+
+    _nowMs = nextMs;
+    if (timerMs <= tickMs) {
+      dispatchTimer();
+    } else {
+      dispatchTick();
+    }
+  }
+
+  _nowMs = _endMs;
+  printReport();
+}
@@ -0,0 +1,279 @@
+#include <pebble.h>
+#include "block_font.h"
+
+// Width in blocks of a glyph and the gap after it, and of a space.
+#define GLYPH_ADVANCE (BLOCK_FONT_WIDTH + 1)
+#define SPACE_ADVANCE 2
+#define LINE_GAP 2
+
+// Returned for characters the font has no glyph for.
+#define UNSUPPORTED_CHARACTER '\x01'
+
+#define GLYPH(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, b14) \
+  ((b0) | ((b1) << 1) | ((b2) << 2) | ((b3) << 3) | ((b4) << 4) | ((b5) << 5) | ((b6) << 6) | \
+   ((b7) << 7) | ((b8) << 8) | ((b9) << 9) | ((b10) << 10) | ((b11) << 11) | ((b12) << 12) | ((b13) << 13) | ((b14) << 14))
+
+typedef struct {
+  char character;
+  uint16_t glyph;
+} SymbolGlyph;
+
+static const uint16_t _digitGlyphs[10] = {
+  GLYPH(1, 1, 1,  1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 1, 1), // 0
+  GLYPH(0, 0, 1,  0, 0, 1,  0, 0, 1,  0, 0, 1,  0, 0, 1), // 1
+  GLYPH(1, 1, 1,  0, 0, 1,  1, 1, 1,  1, 0, 0,  1, 1, 1), // 2
+  GLYPH(1, 1, 1,  0, 0, 1,  1, 1, 1,  0, 0, 1,  1, 1, 1), // 3
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 1, 1,  0, 0, 1,  0, 0, 1), // 4
+  GLYPH(1, 1, 1,  1, 0, 0,  1, 1, 1,  0, 0, 1,  1, 1, 1), // 5
+  GLYPH(1, 1, 1,  1, 0, 0,  1, 1, 1,  1, 0, 1,  1, 1, 1), // 6
+  GLYPH(1, 1, 1,  0, 0, 1,  0, 0, 1,  0, 0, 1,  0, 0, 1), // 7
+  GLYPH(1, 1, 1,  1, 0, 1,  1, 1, 1,  1, 0, 1,  1, 1, 1), // 8
+  GLYPH(1, 1, 1,  1, 0, 1,  1, 1, 1,  0, 0, 1,  1, 1, 1)  // 9
+};
+
+static const uint16_t _letterGlyphs[26] = {
+  GLYPH(0, 1, 0,  1, 0, 1,  1, 1, 1,  1, 0, 1,  1, 0, 1), // A
+  GLYPH(1, 1, 0,  1, 0, 1,  1, 1, 0,  1, 0, 1,  1, 1, 0), // B
+  GLYPH(0, 1, 1,  1, 0, 0,  1, 0, 0,  1, 0, 0,  0, 1, 1), // C
+  GLYPH(1, 1, 0,  1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 1, 0), // D
+  GLYPH(1, 1, 1,  1, 0, 0,  1, 1, 0,  1, 0, 0,  1, 1, 1), // E
+  GLYPH(1, 1, 1,  1, 0, 0,  1, 1, 0,  1, 0, 0,  1, 0, 0), // F
+  GLYPH(0, 1, 1,  1, 0, 0,  1, 0, 1,  1, 0, 1,  0, 1, 1), // G
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 1, 1,  1, 0, 1,  1, 0, 1), // H
+  GLYPH(1, 1, 1,  0, 1, 0,  0, 1, 0,  0, 1, 0,  1, 1, 1), // I
+  GLYPH(0, 0, 1,  0, 0, 1,  0, 0, 1,  1, 0, 1,  0, 1, 0), // J
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 1, 0,  1, 0, 1,  1, 0, 1), // K
+  GLYPH(1, 0, 0,  1, 0, 0,  1, 0, 0,  1, 0, 0,  1, 1, 1), // L
+  GLYPH(1, 0, 1,  1, 1, 1,  1, 1, 1,  1, 0, 1,  1, 0, 1), // M
+  GLYPH(1, 1, 0,  1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 0, 1), // N
+  GLYPH(0, 1, 0,  1, 0, 1,  1, 0, 1,  1, 0, 1,  0, 1, 0), // O
+  GLYPH(1, 1, 0,  1, 0, 1,  1, 1, 0,  1, 0, 0,  1, 0, 0), // P
+  GLYPH(0, 1, 0,  1, 0, 1,  1, 0, 1,  1, 1, 0,  0, 1, 1), // Q
+  GLYPH(1, 1, 0,  1, 0, 1,  1, 1, 0,  1, 0, 1,  1, 0, 1), // R
+  GLYPH(0, 1, 1,  1, 0, 0,  0, 1, 0,  0, 0, 1,  1, 1, 0), // S
+  GLYPH(1, 1, 1,  0, 1, 0,  0, 1, 0,  0, 1, 0,  0, 1, 0), // T
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 1, 1), // U
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 0, 1,  1, 0, 1,  0, 1, 0), // V
+  GLYPH(1, 0, 1,  1, 0, 1,  1, 1, 1,  1, 1, 1,  1, 0, 1), // W
+  GLYPH(1, 0, 1,  1, 0, 1,  0, 1, 0,  1, 0, 1,  1, 0, 1), // X
+  GLYPH(1, 0, 1,  1, 0, 1,  0, 1, 0,  0, 1, 0,  0, 1, 0), // Y
+  GLYPH(1, 1, 1,  0, 0, 1,  0, 1, 0,  1, 0, 0,  1, 1, 1)  // Z
+};
+
+static const SymbolGlyph _symbolGlyphs[] = {
+  { '%', GLYPH(1, 0, 1,  0, 0, 1,  0, 1, 0,  1, 0, 0,  1, 0, 1) },
+  { '!', GLYPH(0, 1, 0,  0, 1, 0,  0, 1, 0,  0, 0, 0,  0, 1, 0) },
+  { '?', GLYPH(1, 1, 0,  0, 0, 1,  0, 1, 0,  0, 0, 0,  0, 1, 0) },
+  { '.', GLYPH(0, 0, 0,  0, 0, 0,  0, 0, 0,  0, 0, 0,  0, 1, 0) },
+  { ',', GLYPH(0, 0, 0,  0, 0, 0,  0, 0, 0,  0, 1, 0,  1, 0, 0) },
+  { ':', GLYPH(0, 0, 0,  0, 1, 0,  0, 0, 0,  0, 1, 0,  0, 0, 0) },
+  { '-', GLYPH(0, 0, 0,  0, 0, 0,  1, 1, 1,  0, 0, 0,  0, 0, 0) },
+  { '/', GLYPH(0, 0, 1,  0, 0, 1,  0, 1, 0,  1, 0, 0,  1, 0, 0) },
+  { '\'', GLYPH(0, 1, 0,  0, 1, 0,  0, 0, 0,  0, 0, 0,  0, 0, 0) },
+  { '(', GLYPH(0, 0, 1,  0, 1, 0,  0, 1, 0,  0, 1, 0,  0, 0, 1) },
+  { ')', GLYPH(1, 0, 0,  0, 1, 0,  0, 1, 0,  0, 1, 0,  1, 0, 0) }
+};
+
+// Latin-1 letters U+00C0 to U+00FF drawn as the letter without its accent.
+static const char _latin1Letters[] =
+  "AAAAAAACEEEEIIII" "DNOOOOO\x01OUUUUY\x01S"
+  "AAAAAAACEEEEIIII" "DNOOOOO\x01OUUUUY\x01Y";
+
+static char nextCharacter(const char **text);
+static int16_t layoutText(GContext *ctx, const char *text, GRect bounds, uint8_t blockSize, GTextAlignment alignment);
+static void drawGlyph(GContext *ctx, uint16_t glyph, GPoint origin, uint8_t blockSize);
+
+uint16_t BlockFontGlyph(char character) {
+  if (character >= '0' && character <= '9') {
+    return _digitGlyphs[character - '0'];
+  
+  } else if (character >= 'A' && character <= 'Z') {
+    return _letterGlyphs[character - 'A'];
+  }
+  
+  for (unsigned int index = 0; index < ARRAY_LENGTH(_symbolGlyphs); index++) {
+    if (_symbolGlyphs[index].character == character) {
+      return _symbolGlyphs[index].glyph;
+    }
+  }
+  
+  return BLOCK_GLYPH_NONE;
+}
+
+// Whether the font has a glyph for every character of the text.
+bool BlockTextCanDraw(const char *text) {
+  while (*text != '\0') {
+    char character = nextCharacter(&text);
+    if (character != ' ' && BlockFontGlyph(character) == BLOCK_GLYPH_NONE) {
+      return false;
+    }
+  }
+  
+  return true;
+}
+
+// Returns the height of the text wrapped to the width, or -1 if a word doesn't fit.
+int16_t BlockTextHeight(const char *text, int16_t width, uint8_t blockSize) {
+  return layoutText(NULL, text, GRect(0, 0, width, 0), blockSize, GTextAlignmentLeft);
+}
+
+// Returns the largest block size, up to maxBlockSize, at which the text wraps
+// into size without breaking a word. Returns 0 if it doesn't fit at any size.
+uint8_t BlockTextFitBlockSize(const char *text, GSize size, uint8_t maxBlockSize) {
+  for (uint8_t blockSize = maxBlockSize; blockSize > 0; blockSize--) {
+    int16_t height = BlockTextHeight(text, size.w, blockSize);
+    if (height >= 0 && height <= size.h) {
+      return blockSize;
+    }
+  }
+  
+  return 0;
+}
+
+// Draws the text in the fill color, wrapped at spaces to the width of bounds
+// and aligned to its top.
+void DrawBlockText(GContext *ctx, const char *text, GRect bounds, uint8_t blockSize, GTextAlignment alignment) {
+  layoutText(ctx, text, bounds, blockSize, alignment);
+}
+
+// Reads one character, upper cased, moving text past it. Accented Latin-1
+// letters come back without their accent.
+static char nextCharacter(const char **text) {
+  uint8_t byte = (uint8_t) **text;
+  (*text)++;
+  
+  if (byte < 0x80) {
+    return (byte >= 'a' && byte <= 'z') ? (char) (byte - 'a' + 'A') : (char) byte;
+  }
+  
+  // Two byte UTF-8 sequence
+  if ((byte & 0xe0) == 0xc0 && (**text & 0xc0) == 0x80) {
+    uint16_t codePoint = ((byte & 0x1f) << 6) | (**text & 0x3f);
+    (*text)++;
+  
+    if (codePoint >= 0xc0 && codePoint <= 0xff) {
+      return _latin1Letters[codePoint - 0xc0];
+    }
+  
+    return UNSUPPORTED_CHARACTER;
+  }
+  
+  // Skip the rest of any longer sequence
+  while ((**text & 0xc0) == 0x80) {
+    (*text)++;
+  }
+  
+  return UNSUPPORTED_CHARACTER;
+}
+
+// Breaks the text into lines that fit the width of bounds, drawing them if
+// ctx isn't NULL. Returns the height of the lines, or -1 if a word is wider
+// than bounds.
+static int16_t layoutText(GContext *ctx, const char *text, GRect bounds, uint8_t blockSize, GTextAlignment alignment) {
+  const char *cursor = text;
+  int16_t y = bounds.origin.y;
+  int16_t numLines = 0;
+  
+  while (true) {
+    while (*cursor == ' ') {
+      cursor++;
+    }
+  
+    if (*cursor == '\0') {
+      break;
+    }
+  
+    // Add words to the line while they fit. Widths are in blocks and include
+    // the gap after the last glyph.
+    const char *lineEnd = cursor;
+    int16_t lineWidth = 0;
+    while (*lineEnd != '\0') {
+      const char *wordStart = lineEnd;
+      int16_t spaceWidth = 0;
+      while (*wordStart == ' ') {
+        wordStart++;
+        spaceWidth += SPACE_ADVANCE;
+      }
+  
+      if (*wordStart == '\0') {
+        break;
+      }
+  
+      const char *wordEnd = wordStart;
+      int16_t wordWidth = 0;
+      while (*wordEnd != '\0' && *wordEnd != ' ') {
+        nextCharacter(&wordEnd);
+        wordWidth += GLYPH_ADVANCE;
+      }
+  
+      int16_t width = (lineWidth == 0) ? wordWidth : (lineWidth + spaceWidth + wordWidth);
+      if ((width - 1) * blockSize > bounds.size.w) {
+        if (lineWidth == 0) {
+          return -1;
+        }
+  
+        break;
+      }
+  
+      lineWidth = width;
+      lineEnd = wordEnd;
+    }
+  
+    if (ctx != NULL) {
+      int16_t x = bounds.origin.x;
+      int16_t spare = bounds.size.w - ((lineWidth - 1) * blockSize);
+      if (alignment == GTextAlignmentCenter) {
+        x += spare / 2;
+  
+      } else if (alignment == GTextAlignmentRight) {
+        x += spare;
+      }
+  
+      while (cursor < lineEnd) {
+        char character = nextCharacter(&cursor);
+        if (character == ' ') {
+          x += SPACE_ADVANCE * blockSize;
+          continue;
+        }
+  
+        uint16_t glyph = BlockFontGlyph(character);
+        if (glyph != BLOCK_GLYPH_NONE) {
+          drawGlyph(ctx, glyph, GPoint(x, y), blockSize);
+        }
+  
+        x += GLYPH_ADVANCE * blockSize;
+      }
+    }
+  
+    cursor = lineEnd;
+    y += (BLOCK_FONT_HEIGHT + LINE_GAP) * blockSize;
+    numLines++;
+  }
+  
+  if (numLines == 0) {
+    return 0;
+  }
+  
+  return (numLines * (BLOCK_FONT_HEIGHT + LINE_GAP) * blockSize) - (LINE_GAP * blockSize);
+}
+
+// Fills each run of lit blocks in a glyph row with one rect.
+static void drawGlyph(GContext *ctx, uint16_t glyph, GPoint origin, uint8_t blockSize) {
+  for (int row = 0; row < BLOCK_FONT_HEIGHT; row++) {
+    int column = 0;
+    while (column < BLOCK_FONT_WIDTH) {
+      if ((glyph & (1 << ((row * BLOCK_FONT_WIDTH) + column))) == 0) {
+        column++;
+        continue;
+      }
+  
+      int runStart = column;
+      while (column < BLOCK_FONT_WIDTH && (glyph & (1 << ((row * BLOCK_FONT_WIDTH) + column)))) {
+        column++;
+      }
+  
+      graphics_fill_rect(ctx, GRect(origin.x + (runStart * blockSize), origin.y + (row * blockSize),
+                                    (column - runStart) * blockSize, blockSize), 0, GCornerNone);
+    }
+  }
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include "common.h"
+
+// Glyphs are 3x5 grids of blocks, the same grid the digit layer draws. Bit n of
+// a glyph is block n, counting left to right, top to bottom.
+#define BLOCK_FONT_WIDTH 3
+#define BLOCK_FONT_HEIGHT 5
+#define BLOCK_GLYPH_NONE 0xffff
+
+uint16_t BlockFontGlyph(char character);
+bool BlockTextCanDraw(const char *text);
+int16_t BlockTextHeight(const char *text, int16_t width, uint8_t blockSize);
+uint8_t BlockTextFitBlockSize(const char *text, GSize size, uint8_t maxBlockSize);
+void DrawBlockText(GContext *ctx, const char *text, GRect bounds, uint8_t blockSize, GTextAlignment alignment);
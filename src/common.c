@@ -1,8 +1,35 @@
 #include <pebble.h>
 #include "common.h"
+#include "image_metadata.auto.h"
 
-static uint16_t getImageHypotenuse(uint32_t imageResourceId);
-static GSize getRotBitmapOffset(uint32_t imageResourceId);
+#define MAX_CACHED_BITMAPS 8
+
+// Arena blocks are kept pointer aligned.
+#define ARENA_ALIGN(size) (((size) + sizeof(void*) - 1) & ~(sizeof(void*) - 1))
+
+typedef struct {
+  uint32_t resourceId;
+  GBitmap *bitmap;
+  uint16_t refCount;
+} CachedBitmap;
+
+typedef struct ArenaBlock {
+  size_t size;
+  struct ArenaBlock *nextFree;
+} ArenaBlock;
+
+// Bitmaps loaded from resources, shared by everything that uses the same resource.
+static CachedBitmap _bitmapCache[MAX_CACHED_BITMAPS];
+
+// One block reserved up front that layer state is carved from. Freed blocks go
+// on a free list and are handed out again for allocations of the same size.
+static uint8_t *_arena = NULL;
+static size_t _arenaSize = 0;
+static size_t _arenaUsed = 0;
+static ArenaBlock *_arenaFreeList = NULL;
+
+static const ImageMetadata* getImageMetadata(uint32_t imageResourceId);
+static void rotBitmapGroupStartRotating(RotBitmapGroup *group);
 
 void AddLayer(Layer* relativeLayer, Layer* newLayer, LayerRelation relation) {
   switch (relation) {
@@ -20,58 +47,179 @@ void AddLayer(Layer* relativeLayer, Layer* newLayer, LayerRelation relation) {
   }
 }
 
+bool CreateArena(size_t size) {
+  _arena = malloc(size);
+  _arenaSize = (_arena != NULL) ? size : 0;
+  _arenaUsed = 0;
+  _arenaFreeList = NULL;
+  
+  return (_arena != NULL);
+}
+
+// Everything allocated from the arena must have been freed first.
+void DestroyArena() {
+  MY_APP_LOG(APP_LOG_LEVEL_DEBUG, "Arena used %i of %i bytes", (int) _arenaUsed, (int) _arenaSize);
+  
+  if (_arena != NULL) {
+    free(_arena);
+    _arena = NULL;
+  }
+  
+  _arenaSize = 0;
+  _arenaUsed = 0;
+  _arenaFreeList = NULL;
+}
+
+// Like malloc, but from the arena. Falls back to the heap when there is no
+// arena or it is full.
+void* ArenaAlloc(size_t size) {
+  size = ARENA_ALIGN(size);
+  
+  // Recycle a freed block of the same size
+  for (ArenaBlock **freeBlock = &_arenaFreeList; *freeBlock != NULL; freeBlock = &(*freeBlock)->nextFree) {
+    if ((*freeBlock)->size == size) {
+      ArenaBlock *block = *freeBlock;
+      *freeBlock = block->nextFree;
+      block->nextFree = NULL;
+      return block + 1;
+    }
+  }
+  
+  if (_arena != NULL && _arenaUsed + sizeof(ArenaBlock) + size <= _arenaSize) {
+    ArenaBlock *block = (ArenaBlock*) (_arena + _arenaUsed);
+    block->size = size;
+    block->nextFree = NULL;
+    _arenaUsed += sizeof(ArenaBlock) + size;
+    return block + 1;
+  }
+  
+  MY_APP_LOG(APP_LOG_LEVEL_WARNING, "Arena full, %i bytes from the heap", (int) size);
+  return malloc(size);
+}
+
+void ArenaFree(void *pointer) {
+  if (pointer == NULL) {
+    return;
+  }
+  
+  if (_arena != NULL && (uint8_t*) pointer > _arena && (uint8_t*) pointer < _arena + _arenaSize) {
+    ArenaBlock *block = ((ArenaBlock*) pointer) - 1;
+    block->nextFree = _arenaFreeList;
+    _arenaFreeList = block;
+    return;
+  }
+  
+  free(pointer);
+}
+
+// Returns the bitmap for the resource, loading it only if it isn't already in use.
+// Every call must be balanced with ReleaseBitmap.
+GBitmap* AcquireBitmap(uint32_t imageResourceId) {
+  CachedBitmap *freeEntry = NULL;
+  
+  for (int index = 0; index < MAX_CACHED_BITMAPS; index++) {
+    if (_bitmapCache[index].refCount > 0 && _bitmapCache[index].resourceId == imageResourceId) {
+      _bitmapCache[index].refCount++;
+      return _bitmapCache[index].bitmap;
+      
+    } else if (_bitmapCache[index].refCount == 0 && freeEntry == NULL) {
+      freeEntry = &_bitmapCache[index];
+    }
+  }
+  
+  GBitmap *bitmap = gbitmap_create_with_resource(imageResourceId);
+  
+  // A full cache still works, the bitmap just isn't shared.
+  if (freeEntry != NULL && bitmap != NULL) {
+    freeEntry->resourceId = imageResourceId;
+    freeEntry->bitmap = bitmap;
+    freeEntry->refCount = 1;
+    
+  } else {
+    MY_APP_LOG(APP_LOG_LEVEL_WARNING, "Bitmap cache full, resource %i not cached", (int) imageResourceId);
+  }
+  
+  return bitmap;
+}
+
+// Destroys the bitmap once nothing else holds it.
+void ReleaseBitmap(GBitmap *bitmap) {
+  if (bitmap == NULL) {
+    return;
+  }
+  
+  for (int index = 0; index < MAX_CACHED_BITMAPS; index++) {
+    if (_bitmapCache[index].refCount > 0 && _bitmapCache[index].bitmap == bitmap) {
+      _bitmapCache[index].refCount--;
+      if (_bitmapCache[index].refCount == 0) {
+        gbitmap_destroy(bitmap);
+        _bitmapCache[index].bitmap = NULL;
+        _bitmapCache[index].resourceId = 0;
+      }
+      
+      return;
+    }
+  }
+  
+  // Not cached
+  gbitmap_destroy(bitmap);
+}
+
 void CreateBitmapGroup(BitmapGroup *group, GRect frame, Layer *relativeLayer, LayerRelation relation, GCompOp compostingMode) {
   group->bitmap = NULL;
-  group->createdBitmap = false;
   group->resourceId = 0;
   group->layer = bitmap_layer_create(frame);
   bitmap_layer_set_compositing_mode(group->layer, compostingMode);
   AddLayer(relativeLayer, (Layer*) group->layer, relation);    
 }
 
-void CreateRotBitmapGroup(RotBitmapGroup *group, Layer *relativeLayer, LayerRelation relation, GBitmap *bitmap, 
+void CreateRotBitmapGroup(RotBitmapGroup *group, Layer *relativeLayer, LayerRelation relation, 
                           uint32_t imageResourceId, GCompOp compostingMode) {
+  group->bitmap = AcquireBitmap(imageResourceId);
+  group->resourceId = imageResourceId;
+  group->compostingMode = compostingMode;
+  group->angle = 0;
   
-  // Create the bitmap if NULL passed for the bitmap parameter
-  if (bitmap == NULL) {
-    group->bitmap = gbitmap_create_with_resource(imageResourceId);
-    group->createdBitmap = true;
+  // Unrotated, so the bitmap is drawn straight into a frame of its own size.
+  group->layer = NULL;
+  group->flatLayer = bitmap_layer_create(GRect(0, 0, group->bitmap->bounds.size.w, group->bitmap->bounds.size.h));
+  bitmap_layer_set_bitmap(group->flatLayer, group->bitmap);
+  bitmap_layer_set_compositing_mode(group->flatLayer, compostingMode);
+  AddLayer(relativeLayer, bitmap_layer_get_layer(group->flatLayer), relation);
+}
+
+// Returns whichever layer currently draws the group.
+Layer* RotBitmapGroupGetLayer(RotBitmapGroup *group) {
+  if (group->layer != NULL) {
+    return (Layer*) group->layer;
+  }
+  
+  return bitmap_layer_get_layer(group->flatLayer);
+}
+
+void RotBitmapGroupSetAngle(RotBitmapGroup *group, int32_t angle) {
+  group->angle = angle;
+  
+  if (group->layer == NULL) {
+    if (angle == 0) {
+      return;
+    }
     
-  } else {
-    group->bitmap = bitmap;
-    group->createdBitmap = false;
+    rotBitmapGroupStartRotating(group);
   }
   
-  group->resourceId = imageResourceId;
-  group->angle = 0;
-  group->layer = rot_bitmap_layer_create(group->bitmap);
-  rot_bitmap_set_compositing_mode(group->layer, compostingMode);
-  AddLayer(relativeLayer, (Layer*) group->layer, relation);
+  rot_bitmap_layer_set_angle(group->layer, PEBBLE_ANGLE_FROM_DEGREE(angle));
 }
 
 // Returns whether the bitmap was changed.
-bool BitmapGroupSetBitmap(BitmapGroup *group, GBitmap *bitmap, uint32_t imageResourceId) {
+bool BitmapGroupSetBitmap(BitmapGroup *group, uint32_t imageResourceId) {
   bool imageChanged = false;
   
   if (group->resourceId != imageResourceId) {
     imageChanged = true;
     
-    if (group->bitmap != NULL && group->createdBitmap) {
-      gbitmap_destroy(group->bitmap);
-    }
-    
-    group->bitmap = NULL;
-    group->resourceId = 0;
-
-    // Create the new bitmap if NULL passed for the bitmap parameter
-    if (bitmap == NULL) {
-      group->bitmap = gbitmap_create_with_resource(imageResourceId);
-      group->createdBitmap = true;
-      
-    } else {
-      group->bitmap = bitmap;
-      group->createdBitmap = false;
-    }
+    ReleaseBitmap(group->bitmap);
+    group->bitmap = AcquireBitmap(imageResourceId);
     
     // Set the new bitmap on the BitmapLayer
     group->resourceId = imageResourceId;
@@ -83,31 +231,26 @@ bool BitmapGroupSetBitmap(BitmapGroup *group, GBitmap *bitmap, uint32_t imageRes
 
 // Returns new GRect frame for the RotBitmapLayer. Frame and bounds will be adjusted to
 // new image, however the frame will most likely not be in the right position.
-GRect RotBitmapGroupChangeBitmap(RotBitmapGroup *group, GBitmap *bitmap, uint32_t imageResourceId) {
-  if (group->bitmap != NULL && group->createdBitmap) {
-    gbitmap_destroy(group->bitmap);
-  }
-
-  group->bitmap = NULL;
-  group->resourceId = 0;
-
-  // Create the new bitmap if NULL passed for the bitmap parameter
-  if (bitmap == NULL) {
-    group->bitmap = gbitmap_create_with_resource(imageResourceId);
-    group->createdBitmap = true;
+GRect RotBitmapGroupChangeBitmap(RotBitmapGroup *group, uint32_t imageResourceId) {
+  ReleaseBitmap(group->bitmap);
+  group->bitmap = AcquireBitmap(imageResourceId);
+  group->resourceId = imageResourceId;
+  
+  if (group->layer == NULL) {
+    bitmap_layer_set_bitmap(group->flatLayer, group->bitmap);
     
-  } else {
-    group->bitmap = bitmap;
-    group->createdBitmap = false;
+    GRect frame = layer_get_frame(bitmap_layer_get_layer(group->flatLayer));
+    frame.size = group->bitmap->bounds.size;
+    layer_set_frame(bitmap_layer_get_layer(group->flatLayer), frame);
+    return frame;
   }
   
   // Set the new bitmap on the RotBitmapLayer
-  group->resourceId = imageResourceId;
   bitmap_layer_set_bitmap((BitmapLayer*) group->layer, group->bitmap);
 
   // Get the hypotenuse of the new image which is what the RotBitmapLayer uses
   // for the frame width & height.
-  uint16_t hypotenuse = getImageHypotenuse(imageResourceId);
+  uint16_t hypotenuse = getImageMetadata(imageResourceId)->hypotenuse;
 
   // Adjust the frame size
   GRect rotFrame = layer_get_frame((Layer*) group->layer);   
@@ -125,24 +268,30 @@ GRect RotBitmapGroupChangeBitmap(RotBitmapGroup *group, GBitmap *bitmap, uint32_
   return rotFrame;
 }
 
+// While the group is unrotated its frame is the bitmap rect itself.
 GRect RotRectFromBitmapRect(RotBitmapGroup *group, GRect bitmapRect) {
-  GSize offset = getRotBitmapOffset(group->resourceId);
+  if (group->layer == NULL) {
+    return bitmapRect;
+  }
+  
+  GSize offset = getImageMetadata(group->resourceId)->offset;
   GRect rotRect = layer_get_frame((Layer*) group->layer);
   return GRect(bitmapRect.origin.x - offset.w, bitmapRect.origin.y - offset.h, rotRect.size.w, rotRect.size.h);
 }
 
 GRect BitmapRectFromRotRect(RotBitmapGroup *group, GRect rotRect) {
-  GSize offset = getRotBitmapOffset(group->resourceId);
   GRect bitmapRect = group->bitmap->bounds;
+  if (group->layer == NULL) {
+    return GRect(rotRect.origin.x, rotRect.origin.y, bitmapRect.size.w, bitmapRect.size.h);
+  }
+  
+  GSize offset = getImageMetadata(group->resourceId)->offset;
   return GRect(rotRect.origin.x + offset.w, rotRect.origin.y + offset.h, bitmapRect.size.w, bitmapRect.size.h);
 }
 
 void DestroyBitmapGroup(BitmapGroup *group) {
   if (group != NULL) {
-    if (group->bitmap != NULL && group->createdBitmap) {
-      gbitmap_destroy(group->bitmap);
-    }
-    
+    ReleaseBitmap(group->bitmap);
     group->bitmap = NULL;
     group->resourceId = 0;
     
@@ -156,10 +305,7 @@ void DestroyBitmapGroup(BitmapGroup *group) {
 
 void DestroyRotBitmapGroup(RotBitmapGroup *group) {
   if (group != NULL) {
-    if (group->bitmap != NULL && group->createdBitmap) {
-      gbitmap_destroy(group->bitmap);
-    }
-    
+    ReleaseBitmap(group->bitmap);
     group->bitmap = NULL;
     group->resourceId = 0;
     
@@ -168,54 +314,38 @@ void DestroyRotBitmapGroup(RotBitmapGroup *group) {
       rot_bitmap_layer_destroy(group->layer);
       group->layer = NULL;
     }
+    
+    if (group->flatLayer != NULL) {
+      layer_remove_from_parent(bitmap_layer_get_layer(group->flatLayer));
+      bitmap_layer_destroy(group->flatLayer);
+      group->flatLayer = NULL;
+    }
   }
 }
 
-static uint16_t getImageHypotenuse(uint32_t imageResourceId) {
-  uint16_t hypotenuse = 0;
+// Replaces the flat BitmapLayer with a RotBitmapLayer in the same place in the
+// layer tree, keeping the bitmap where it was on screen.
+static void rotBitmapGroupStartRotating(RotBitmapGroup *group) {
+  Layer *flatLayer = bitmap_layer_get_layer(group->flatLayer);
+  GRect bitmapRect = layer_get_frame(flatLayer);
   
-  switch (imageResourceId) {
-    case RESOURCE_ID_IMAGE_BLOCK_WHITE_9x9:
-      hypotenuse = 12;    // 12.73
-      break;
-    
-    case RESOURCE_ID_IMAGE_AM:
-    case RESOURCE_ID_IMAGE_PM:
-      hypotenuse = 16;    // 16.64
-      break;
-    
-    case RESOURCE_ID_IMAGE_WIPER:
-      hypotenuse = 133;    // 133.63
-      break;
-    
-    default:
-      break;
-  }
+  group->layer = rot_bitmap_layer_create(group->bitmap);
+  rot_bitmap_set_compositing_mode(group->layer, group->compostingMode);
+  layer_set_frame((Layer*) group->layer, RotRectFromBitmapRect(group, bitmapRect));
+  layer_set_hidden((Layer*) group->layer, layer_get_hidden(flatLayer));
+  layer_insert_above_sibling((Layer*) group->layer, flatLayer);
   
-  return hypotenuse;
+  layer_remove_from_parent(flatLayer);
+  bitmap_layer_destroy(group->flatLayer);
+  group->flatLayer = NULL;
 }
 
-// Get the offset of the unrotated bitmap inside the RotBitmap
-static GSize getRotBitmapOffset(uint32_t imageResourceId) {
-  GSize offset = { 0, 0 };
+static const ImageMetadata* getImageMetadata(uint32_t imageResourceId) {
+  static const ImageMetadata noMetadata = { { 0, 0 }, 0, { 0, 0 } };
   
-  switch (imageResourceId) {
-    case RESOURCE_ID_IMAGE_BLOCK_WHITE_9x9:
-      offset = GSize(2, 2);
-      break;
-    
-    case RESOURCE_ID_IMAGE_AM:
-    case RESOURCE_ID_IMAGE_PM:
-      offset = GSize(1, 3);
-      break;
-    
-    case RESOURCE_ID_IMAGE_WIPER:
-      offset = GSize(0, 60);
-      break;
-     
-    default:
-      break;
+  if (imageResourceId >= ARRAY_LENGTH(_imageMetadata)) {
+    return &noMetadata;
   }
   
-  return offset;
+  return &_imageMetadata[imageResourceId];
 }
\ No newline at end of file
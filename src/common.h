@@ -5,9 +5,6 @@
 #define SCREEN_WIDTH 144
 #define SCREEN_HEIGHT 168
   
-// Delay animations to give the watchface animation to finish when it is first launched.
-#define FIRST_DISPLAY_ANIMATION_DELAY 500
-  
 #define PEBBLE_ANGLE_PER_DEGREE (TRIG_MAX_ANGLE / 360)
 
 // Convert degree to Pebble angle
@@ -22,18 +19,27 @@
 
 typedef enum { CHILD, ABOVE_SIBLING, BELOW_SIBLING } LayerRelation;
 
+// Generated per image from appinfo.json, see tools/gen_image_metadata.py
+typedef struct {
+  GSize size;
+  uint16_t hypotenuse;    // Width & height of the RotBitmapLayer frame
+  GSize offset;           // Offset of the unrotated bitmap inside the RotBitmapLayer
+} ImageMetadata;
+
 typedef struct {
   BitmapLayer *layer;
   GBitmap *bitmap;
   uint32_t resourceId;
-  bool createdBitmap;
 } BitmapGroup;
 
+// Drawn with a plain BitmapLayer until the first non-zero angle is set, after
+// which it is swapped for a RotBitmapLayer.
 typedef struct {
-  RotBitmapLayer *layer;
+  RotBitmapLayer *layer;      // NULL until the group is rotated
+  BitmapLayer *flatLayer;     // NULL once the group is rotated
   GBitmap *bitmap;
   uint32_t resourceId;
-  bool createdBitmap;
+  GCompOp compostingMode;
   int32_t angle;        // Angle in degrees
 } RotBitmapGroup;
   
@@ -47,11 +53,19 @@ typedef struct {
 } RotAnimation;
 
 void AddLayer(Layer *relativeLayer, Layer *newLayer, LayerRelation relation);
+bool CreateArena(size_t size);
+void DestroyArena();
+void* ArenaAlloc(size_t size);
+void ArenaFree(void *pointer);
+GBitmap* AcquireBitmap(uint32_t imageResourceId);
+void ReleaseBitmap(GBitmap *bitmap);
 void CreateBitmapGroup(BitmapGroup *group, GRect frame, Layer *relativeLayer, LayerRelation relation, GCompOp compostingMode);
-bool BitmapGroupSetBitmap(BitmapGroup *group, GBitmap *bitmap, uint32_t imageResourceId);
+bool BitmapGroupSetBitmap(BitmapGroup *group, uint32_t imageResourceId);
 void DestroyBitmapGroup(BitmapGroup *group);
-void CreateRotBitmapGroup(RotBitmapGroup *group, Layer *relativeLayer, LayerRelation relation, GBitmap *bitmap, uint32_t imageResourceId, GCompOp compostingMode);
-GRect RotBitmapGroupChangeBitmap(RotBitmapGroup *group, GBitmap *bitmap, uint32_t imageResourceId);
+void CreateRotBitmapGroup(RotBitmapGroup *group, Layer *relativeLayer, LayerRelation relation, uint32_t imageResourceId, GCompOp compostingMode);
+Layer* RotBitmapGroupGetLayer(RotBitmapGroup *group);
+void RotBitmapGroupSetAngle(RotBitmapGroup *group, int32_t angle);
+GRect RotBitmapGroupChangeBitmap(RotBitmapGroup *group, uint32_t imageResourceId);
 GRect RotRectFromBitmapRect(RotBitmapGroup *group, GRect bitmapRect);
 GRect BitmapRectFromRotRect(RotBitmapGroup *group, GRect rotRect);
 void DestroyRotBitmapGroup(RotBitmapGroup *group);
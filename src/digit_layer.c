@@ -1,10 +1,13 @@
 #include <pebble.h>
 #include "digit_layer.h"
+#include "block_font.h"
   
 #define BLOCK_IMAGE_RESOURCE_ID RESOURCE_ID_IMAGE_BLOCK_WHITE_9x9
 #define BLOCK_WIDTH 9
 #define BLOCK_HEIGHT 9
 #define BLOCK_DIVIDER 0
+#define DIGIT_WIDTH ((BLOCK_WIDTH * 3) + (BLOCK_DIVIDER * 2))
+#define DIGIT_HEIGHT ((BLOCK_HEIGHT * 5) + (BLOCK_DIVIDER * 4))
   
 #define SPOT_DURATION 75
 
@@ -26,46 +29,44 @@ static GRect _blockDefinition[NUM_BLOCKS] = {
   { {(BLOCK_WIDTH + BLOCK_DIVIDER) * 2, (BLOCK_HEIGHT + BLOCK_DIVIDER) * 4}, {BLOCK_WIDTH, BLOCK_HEIGHT} }
 };
 
-static uint16_t _numberDefinition[10][NUM_BLOCKS] = {
-/*{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14 } */
-  { 1, 1, 1, 1, 0, 1, 1, 0, 1, 1,  0,  1,  1,  1,  1 }, // 0
-  { 0, 0, 1, 0, 0, 1, 0, 0, 1, 0,  0,  1,  0,  0,  1 }, // 1
-  { 1, 1, 1, 0, 0, 1, 1, 1, 1, 1,  0,  0,  1,  1,  1 }, // 2
-  { 1, 1, 1, 0, 0, 1, 1, 1, 1, 0,  0,  1,  1,  1,  1 }, // 3
-  { 1, 0, 1, 1, 0, 1, 1, 1, 1, 0,  0,  1,  0,  0,  1 }, // 4
-  { 1, 1, 1, 1, 0, 0, 1, 1, 1, 0,  0,  1,  1,  1,  1 }, // 5
-  { 1, 1, 1, 1, 0, 0, 1, 1, 1, 1,  0,  1,  1,  1,  1 }, // 6
-  { 1, 1, 1, 0, 0, 1, 0, 0, 1, 0,  0,  1,  0,  0,  1 }, // 7
-  { 1, 1, 1, 1, 0, 1, 1, 1, 1, 1,  0,  1,  1,  1,  1 }, // 8
-  { 1, 1, 1, 1, 0, 1, 1, 1, 1, 0,  0,  1,  1,  1,  1 }  // 9
-};
-
 static uint16_t _randomSpots[NUM_BLOCKS] = {
   2, 6, 10, 0, 13, 5, 4, 12, 11, 7, 14, 1, 8, 9, 3
 };
 
-static void destoryBlockAnimation(Block *block);
+// Every digit fully drawn, side by side, shared by all digit layers. A digit
+// that has finished drawing is one blit of its glyph.
+static GBitmap *_glyphAtlas = NULL;
+static GBitmap *_glyphs[10];
+static uint16_t _glyphAtlasUsers = 0;
+
+static void digitLayerUpdateProc(Layer *layer, GContext *ctx);
 static void spotTimerCallback(void *callback_data);
 static void digitClear(DigitLayerData *data);
 static void digitSpots(DigitLayerData *data);
+static bool spotChanges(DigitLayerData *data, int16_t spotIndex);
+static uint16_t getDigitBlocks(int16_t digit);
+static void createGlyphAtlas(GBitmap *blockBitmap);
+static void destroyGlyphAtlas();
+static void copyBitmap(GBitmap *dest, GPoint origin, GBitmap *source);
 
 DigitLayerData* CreateDigitLayer(Layer *relativeLayer, LayerRelation relation, GPoint origin) {
-  DigitLayerData* data = malloc(sizeof(DigitLayerData));
+  DigitLayerData* data = ArenaAlloc(sizeof(DigitLayerData));
   if (data != NULL) {
     memset(data, 0, sizeof(DigitLayerData));
     
     data->digit = -1;
-    data->bitmap = gbitmap_create_with_resource(BLOCK_IMAGE_RESOURCE_ID);
+    data->bitmap = AcquireBitmap(BLOCK_IMAGE_RESOURCE_ID);
     data->origin = origin;
-    data->layer = layer_create(GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT));
-    AddLayer(relativeLayer, data->layer, relation);
     
-    for (int blockIndex = 0; blockIndex < TOTAL_NUM_BLOCKS; blockIndex++) {
-      CreateRotBitmapGroup(&data->blocks[blockIndex].group, data->layer, CHILD, data->bitmap, 
-                           BLOCK_IMAGE_RESOURCE_ID, GCompOpAssign);
-      
-      layer_set_hidden((Layer*) data->blocks[blockIndex].group.layer, true);
+    if (_glyphAtlasUsers++ == 0 && data->bitmap != NULL) {
+      createGlyphAtlas(data->bitmap);
     }
+    
+    // One layer draws all visible blocks of the digit. The layer data points back to the digit.
+    data->layer = layer_create_with_data(GRect(origin.x, origin.y, DIGIT_WIDTH, DIGIT_HEIGHT), sizeof(DigitLayerData*));
+    *(DigitLayerData**) layer_get_data(data->layer) = data;
+    layer_set_update_proc(data->layer, digitLayerUpdateProc);
+    AddLayer(relativeLayer, data->layer, relation);
   }
       
   return data;
@@ -77,13 +78,68 @@ void DrawDigitLayer(DigitLayerData *data, uint16_t hour, uint16_t minute) {
 void ConstructDigit(DigitLayerData *data, uint16_t digit, DigitFinishedCallback finishedCallback, void *digitFinishedCallbackData) {
   DeconstructDigit(data, NULL, NULL);
   data->digit = digit;
+  data->targetBlocks = getDigitBlocks(digit);
+  data->morphing = false;
+  data->finishedCallback = finishedCallback;
+  data->digitFinishedCallbackData = digitFinishedCallbackData;
+  digitSpots(data);
+}
+
+// Shows the whole digit at once, stopping any drawing still under way. A digit
+// of -1 shows blank.
+void ShowDigit(DigitLayerData *data, int16_t digit) {
+  if (data->spotTimer != NULL) {
+    app_timer_cancel(data->spotTimer);
+    data->spotTimer = NULL;
+  }
+  
+  data->digit = digit;
+  data->targetBlocks = getDigitBlocks(digit);
+  data->morphing = false;
+  data->finishedCallback = NULL;
+  data->digitFinishedCallbackData = NULL;
+  
+  if (data->visibleBlocks != data->targetBlocks) {
+    data->visibleBlocks = data->targetBlocks;
+    layer_mark_dirty(data->layer);
+  }
+}
+
+// Changes the displayed digit by turning on or off only the blocks that differ
+// between the two digits. A digit of -1 morphs to blank.
+void MorphDigit(DigitLayerData *data, int16_t digit, DigitFinishedCallback finishedCallback, void *digitFinishedCallbackData) {
+  if (data->spotTimer != NULL) {
+    app_timer_cancel(data->spotTimer);
+    data->spotTimer = NULL;
+  }
+  
+  data->digit = digit;
+  data->targetBlocks = getDigitBlocks(digit);
+  data->morphing = true;
   data->finishedCallback = finishedCallback;
   data->digitFinishedCallbackData = digitFinishedCallbackData;
+  
+  if (data->visibleBlocks == data->targetBlocks) {
+    if (data->finishedCallback != NULL) {
+      data->finishedCallback(data->digitFinishedCallbackData);
+    }
+    
+    return;
+  }
+  
   digitSpots(data);
 }
 
 static void digitSpots(DigitLayerData *data) {
   data->startSpotIndex = rand() % NUM_BLOCKS;
+  
+  // Start on a spot that changes, so the first tick isn't wasted.
+  if (data->morphing) {
+    while (!spotChanges(data, data->startSpotIndex)) {
+      data->startSpotIndex = (data->startSpotIndex + 1) % NUM_BLOCKS;
+    }
+  }
+  
   data->spotIndex = data->startSpotIndex;
   data->spotTimer = app_timer_register(SPOT_DURATION, spotTimerCallback, (void*) data);
 }
@@ -98,19 +154,16 @@ void DeconstructDigit(DigitLayerData *data, DigitFinishedCallback finishedCallba
   data->finishedCallback = finishedCallback;
   data->digitFinishedCallbackData = digitFinishedCallbackData;
   
-  // Clean up previous animations
-  for (int blockIndex = 0; blockIndex < TOTAL_NUM_BLOCKS; blockIndex++) {
-    destoryBlockAnimation(&data->blocks[blockIndex]);
-  }
-
   digitClear(data);
   
   data->digit = -1;
+  data->targetBlocks = 0;
 }
 
 static void digitClear(DigitLayerData *data) {
-  for (int blockIndex = 0; blockIndex < TOTAL_NUM_BLOCKS; blockIndex++) {
-    layer_set_hidden((Layer*) data->blocks[blockIndex].group.layer, true);
+  if (data->visibleBlocks != 0) {
+    data->visibleBlocks = 0;
+    layer_mark_dirty(data->layer);
   }
   
   if (data->finishedCallback != NULL) {
@@ -125,11 +178,6 @@ void DestroyDigitLayer(DigitLayerData *data) {
       data->spotTimer = NULL;
     }
     
-    for (int blockIndex = 0; blockIndex < TOTAL_NUM_BLOCKS; blockIndex++) {
-      destoryBlockAnimation(&data->blocks[blockIndex]);
-      DestroyRotBitmapGroup(&data->blocks[blockIndex].group);
-    }
-    
     if (data->layer != NULL) {
       layer_remove_from_parent(data->layer);
       layer_destroy(data->layer);
@@ -137,22 +185,34 @@ void DestroyDigitLayer(DigitLayerData *data) {
     }
     
     if (data->bitmap != NULL) {
-      gbitmap_destroy(data->bitmap);
+      ReleaseBitmap(data->bitmap);
       data->bitmap = NULL;
     }
     
-    free(data);
+    if (--_glyphAtlasUsers == 0) {
+      destroyGlyphAtlas();
+    }
+    
+    ArenaFree(data);
   }
 }
 
-static void destoryBlockAnimation(Block *block) {
-  if (block->animation != NULL) {
-    if (animation_is_scheduled((Animation*) block->animation)) {
-      animation_unschedule((Animation*) block->animation);
+static void digitLayerUpdateProc(Layer *layer, GContext *ctx) {
+  DigitLayerData *data = *(DigitLayerData**) layer_get_data(layer);
+  
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+  
+  // Finished digits come straight from the atlas
+  bool finished = (data->spotTimer == NULL && data->visibleBlocks == data->targetBlocks);
+  if (finished && data->digit >= 0 && data->digit <= 9 && _glyphs[data->digit] != NULL) {
+    graphics_draw_bitmap_in_rect(ctx, _glyphs[data->digit], GRect(0, 0, DIGIT_WIDTH, DIGIT_HEIGHT));
+    return;
+  }
+  
+  for (int blockIndex = 0; blockIndex < NUM_BLOCKS; blockIndex++) {
+    if (data->visibleBlocks & (1 << blockIndex)) {
+      graphics_draw_bitmap_in_rect(ctx, data->bitmap, _blockDefinition[blockIndex]);
     }
-
-    property_animation_destroy(block->animation);
-    block->animation = NULL;
   }
 }
 
@@ -160,23 +220,19 @@ static void spotTimerCallback(void *callback_data) {
   DigitLayerData* data = (DigitLayerData*) callback_data;
   data->spotTimer = NULL;
   
-  uint16_t *blocks = _numberDefinition[data->digit];
-  int16_t blockIndex = _randomSpots[data->spotIndex];
-  
-  if (blocks[blockIndex] == 1) {
-    GRect blockFrame = RotRectFromBitmapRect(&data->blocks[blockIndex].group, _blockDefinition[blockIndex]);
-    blockFrame.origin.x += data->origin.x;
-    blockFrame.origin.y += data->origin.y;
-    
-    layer_set_frame((Layer*) data->blocks[blockIndex].group.layer, blockFrame);
-    layer_set_hidden((Layer*) data->blocks[blockIndex].group.layer, false);
-  }
-    
-  data->spotIndex++;
-  if (data->spotIndex == NUM_BLOCKS) {
-    data->spotIndex = 0;
+  if (spotChanges(data, data->spotIndex)) {
+    data->visibleBlocks ^= (1 << _randomSpots[data->spotIndex]);
+    layer_mark_dirty(data->layer);
   }
   
+  // When morphing, spots whose block is already right are skipped.
+  do {
+    data->spotIndex++;
+    if (data->spotIndex == NUM_BLOCKS) {
+      data->spotIndex = 0;
+    }
+  } while (data->morphing && data->spotIndex != data->startSpotIndex && !spotChanges(data, data->spotIndex));
+  
   if (data->spotIndex != data->startSpotIndex) {
     data->spotTimer = app_timer_register(SPOT_DURATION, spotTimerCallback, (void*) data);
     
@@ -184,3 +240,70 @@ static void spotTimerCallback(void *callback_data) {
     data->finishedCallback(data->digitFinishedCallbackData);
   }
 }
+
+// Whether the block at the spot differs between what is shown and the digit being drawn.
+static bool spotChanges(DigitLayerData *data, int16_t spotIndex) {
+  return ((data->visibleBlocks ^ data->targetBlocks) & (1 << _randomSpots[spotIndex])) != 0;
+}
+
+static uint16_t getDigitBlocks(int16_t digit) {
+  if (digit < 0 || digit > 9) {
+    return 0;
+  }
+  
+  return BlockFontGlyph('0' + digit);
+}
+
+// Draws each digit's blocks into the atlas. Blocks that aren't lit stay black,
+// the same as the background the blocks are drawn over.
+static void createGlyphAtlas(GBitmap *blockBitmap) {
+  _glyphAtlas = gbitmap_create_blank(GSize(DIGIT_WIDTH * 10, DIGIT_HEIGHT));
+  if (_glyphAtlas == NULL) {
+    return;
+  }
+  
+  for (int digit = 0; digit < 10; digit++) {
+    for (int blockIndex = 0; blockIndex < NUM_BLOCKS; blockIndex++) {
+      if (getDigitBlocks(digit) & (1 << blockIndex)) {
+        GPoint blockOrigin = _blockDefinition[blockIndex].origin;
+        copyBitmap(_glyphAtlas, GPoint((digit * DIGIT_WIDTH) + blockOrigin.x, blockOrigin.y), blockBitmap);
+      }
+    }
+    
+    _glyphs[digit] = gbitmap_create_as_sub_bitmap(_glyphAtlas, GRect(digit * DIGIT_WIDTH, 0, DIGIT_WIDTH, DIGIT_HEIGHT));
+  }
+}
+
+static void destroyGlyphAtlas() {
+  for (int digit = 0; digit < 10; digit++) {
+    if (_glyphs[digit] != NULL) {
+      gbitmap_destroy(_glyphs[digit]);
+      _glyphs[digit] = NULL;
+    }
+  }
+  
+  if (_glyphAtlas != NULL) {
+    gbitmap_destroy(_glyphAtlas);
+    _glyphAtlas = NULL;
+  }
+}
+
+// Copies the source bitmap's pixels into dest at origin.
+static void copyBitmap(GBitmap *dest, GPoint origin, GBitmap *source) {
+  for (int y = 0; y < source->bounds.size.h; y++) {
+    uint8_t *sourceRow = (uint8_t*) source->addr + ((source->bounds.origin.y + y) * source->row_size_bytes);
+    uint8_t *destRow = (uint8_t*) dest->addr + ((origin.y + y) * dest->row_size_bytes);
+    
+    for (int x = 0; x < source->bounds.size.w; x++) {
+      int16_t sourceX = source->bounds.origin.x + x;
+      int16_t destX = origin.x + x;
+      
+      if (sourceRow[sourceX >> 3] & (1 << (sourceX & 7))) {
+        destRow[destX >> 3] |= (1 << (destX & 7));
+        
+      } else {
+        destRow[destX >> 3] &= ~(1 << (destX & 7));
+      }
+    }
+  }
+}
@@ -10,13 +10,32 @@
 
 #define KEY_BLUETOOTH_VIBRATE 0
 #define KEY_USAGE_DURATION 1
+#define KEY_ANIMATE_ON_FLICK 2
+#define KEY_QUIET_HOURS 3
+#define KEY_QUIET_START 4
+#define KEY_QUIET_END 5
+#define KEY_QUIET_INTERVAL 6
+#define KEY_REDUCE_ANIMATION_BATTERY 7
+#define KEY_STOP_ANIMATION_BATTERY 8
 #define KEY_LAST_USAGE_RECORD_DAY 100
   
 #define MESSAGE_SETTINGS_DURATION 1500
 #define MESSAGE_BLUETOOTH_DURATION 5000
 
+// Holds the state of every layer and the wiper sprites. The host build peaks at
+// 3168 bytes with a bluetooth message up, using 64-bit pointers, so this leaves
+// at least 416 bytes spare on the watch.
+#define LAYER_ARENA_SIZE 3584
+
 typedef struct {
   int32_t bluetoothVibrate;
+  int32_t animateOnFlick;     // Animate only when the wrist is flicked to look
+  int32_t quietHours;         // No animation from quietStart up to quietEnd
+  int32_t quietStart;         // Hour of the day
+  int32_t quietEnd;
+  int32_t quietInterval;      // Minutes between updates during quiet hours
+  int32_t reduceAnimationBattery;  // Charge percent at or below which the wipe is cut short, -1 for never
+  int32_t stopAnimationBattery;    // Charge percent at or below which nothing animates, -1 for never
 } Settings;
 
 static Window *_mainWindow = NULL;
@@ -26,6 +45,9 @@ static StatusLayerData *_statusData = NULL;
 static Settings _settings;
 static AppTimer *_messageTimer = NULL;
 static AppTimer *_fiveMinuteTimer = NULL;
+static bool _hasFocus = true;
+static bool _tapSubscribed = false;
+static time_t _flickMinute = -1;  // Minute since the epoch the last flick was animated in
 
 // Message window strings
 static const char *_settingsReceivedMsg = "Settings received!";
@@ -42,6 +64,12 @@ static void main_window_unload(Window *window);
 static void timer_handler(struct tm *tick_time, TimeUnits units_changed);
 static void bluetooth_service_handler(bool connected);
 static void battery_service_handler(BatteryChargeState charge_state);
+static void app_focus_handler(bool in_focus);
+static void accel_tap_handler(AccelAxisType axis, int32_t direction);
+static void subscribeTapService();
+static bool isQuietHour(uint16_t hour);
+static void updateTimeAnimation(BatteryChargeState charge_state);
+static bool isOnExternalPower(BatteryChargeState charge_state);
 static void inbox_received_callback(DictionaryIterator *iterator, void *context);
 static void inbox_dropped_callback(AppMessageResult reason, void *context);
 static void outbox_sent_callback(DictionaryIterator *values, void *context);
@@ -54,7 +82,7 @@ static void showMessage(const char *text, uint32_t duration);
 static void messageTimerCallback(void *callback_data);
 static void fiveMinuteTimerCallback(void *callback_data);
 static struct tm* getTime(struct tm *real_time);
-static void drawWatchFace(struct tm *tick_time);
+static void drawWatchFace(struct tm *tick_time, bool minuteTick);
 
 int main(void) {
   init();
@@ -94,6 +122,12 @@ static void init() {
   // Register battery service
   battery_state_service_subscribe(battery_service_handler);
   
+  // Register app focus service
+  app_focus_service_subscribe(app_focus_handler);
+  
+  // Register tap service when animating on wrist flicks
+  subscribeTapService();
+  
   // Register AppMessage callbacks
   app_message_register_inbox_received(inbox_received_callback);
   app_message_register_inbox_dropped(inbox_dropped_callback);
@@ -116,6 +150,10 @@ static void init() {
 static void deinit() {
   bluetooth_connection_service_unsubscribe();
   battery_state_service_unsubscribe();
+  app_focus_service_unsubscribe();
+  if (_tapSubscribed) {
+    accel_tap_service_unsubscribe();
+  }
   animation_unschedule_all();
   
   if (_messageTimer != NULL) {
@@ -143,6 +181,7 @@ static void deinit() {
 
 static void main_window_load(Window *window) {
   window_set_background_color(window, GColorBlack);
+  CreateArena(LAYER_ARENA_SIZE);
     
   _timeData = CreateTimeLayer(window_get_root_layer(_mainWindow), CHILD);
   _statusData = CreateStatusLayer(window_get_root_layer(_mainWindow), CHILD);
@@ -154,10 +193,11 @@ static void main_window_load(Window *window) {
   
   // Initialize battery status
   BatteryChargeState batteryState = battery_state_service_peek();
-  ShowBatteryStatus(_statusData, (batteryState.is_charging || batteryState.is_plugged));
+  ShowBatteryStatus(_statusData, isOnExternalPower(batteryState));
   UpdateBatteryStatus(_statusData, batteryState);
+  updateTimeAnimation(batteryState);
   
-  drawWatchFace(getTime(NULL));
+  drawWatchFace(getTime(NULL), false);
 }
 
 static void main_window_unload(Window *window) {
@@ -171,11 +211,13 @@ static void main_window_unload(Window *window) {
   
   DestroyTimeLayer(_timeData);
   _timeData = NULL;
+  
+  DestroyArena();
 }
 
 static void timer_handler(struct tm *tick_time, TimeUnits units_changed) {
   struct tm *localNow = getTime(tick_time);
-  drawWatchFace(localNow);
+  drawWatchFace(localNow, true);
   
 #ifndef RUN_TEST
   // A new day has begun. Start usage timer for today.
@@ -195,6 +237,41 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
         MY_APP_LOG(APP_LOG_LEVEL_INFO, "Bluetooth vibrate %i", (int) _settings.bluetoothVibrate);
         break;
       
+      case KEY_ANIMATE_ON_FLICK:
+        _settings.animateOnFlick = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Animate on flick %i", (int) _settings.animateOnFlick);
+        break;
+      
+      case KEY_QUIET_HOURS:
+        _settings.quietHours = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Quiet hours %i", (int) _settings.quietHours);
+        break;
+      
+      case KEY_QUIET_START:
+        _settings.quietStart = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Quiet start %i", (int) _settings.quietStart);
+        break;
+      
+      case KEY_QUIET_END:
+        _settings.quietEnd = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Quiet end %i", (int) _settings.quietEnd);
+        break;
+      
+      case KEY_QUIET_INTERVAL:
+        _settings.quietInterval = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Quiet interval %i", (int) _settings.quietInterval);
+        break;
+      
+      case KEY_REDUCE_ANIMATION_BATTERY:
+        _settings.reduceAnimationBattery = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Reduce animation battery %i", (int) _settings.reduceAnimationBattery);
+        break;
+      
+      case KEY_STOP_ANIMATION_BATTERY:
+        _settings.stopAnimationBattery = tuple->value->int32;
+        MY_APP_LOG(APP_LOG_LEVEL_INFO, "Stop animation battery %i", (int) _settings.stopAnimationBattery);
+        break;
+      
       default:
         MY_APP_LOG(APP_LOG_LEVEL_ERROR, "Key %i not recognized", (int) tuple->key);
         break;
@@ -204,6 +281,8 @@ static void inbox_received_callback(DictionaryIterator *iterator, void *context)
   }
   
   saveSettings(&_settings);
+  subscribeTapService();
+  updateTimeAnimation(battery_state_service_peek());
   showMessage(_settingsReceivedMsg, MESSAGE_SETTINGS_DURATION);    
 }
 
@@ -245,17 +324,110 @@ static void bluetooth_service_handler(bool connected) {
 }
 
 static void battery_service_handler(BatteryChargeState charge_state) {
-  ShowBatteryStatus(_statusData, (charge_state.is_charging || charge_state.is_plugged));
+  ShowBatteryStatus(_statusData, isOnExternalPower(charge_state));
   UpdateBatteryStatus(_statusData, charge_state);
+  updateTimeAnimation(charge_state);
+}
+
+// The animation is cut back as the battery runs down, unless on external power.
+static void updateTimeAnimation(BatteryChargeState charge_state) {
+  if (_timeData == NULL) {
+    return;
+  }
+  
+  TimeAnimation animation = TIME_ANIMATION_FULL;
+  if (!isOnExternalPower(charge_state)) {
+    if (charge_state.charge_percent <= _settings.stopAnimationBattery) {
+      animation = TIME_ANIMATION_NONE;
+      
+    } else if (charge_state.charge_percent <= _settings.reduceAnimationBattery) {
+      animation = TIME_ANIMATION_REDUCED;
+    }
+  }
+  
+  SetTimeAnimation(_timeData, animation);
+}
+
+// Charging or plugged in, the battery status shows and the full animation plays.
+static bool isOnExternalPower(BatteryChargeState charge_state) {
+  return (charge_state.is_charging || charge_state.is_plugged);
+}
+
+// Nobody sees the animation under a notification, so the time is shown
+// finished while one covers the face and is ready when it goes.
+static void app_focus_handler(bool in_focus) {
+  _hasFocus = in_focus;
+  if (!in_focus && _timeData != NULL) {
+    struct tm *localNow = getTime(NULL);
+    RenderTimeImmediate(_timeData, localNow->tm_hour, localNow->tm_min);
+  }
+}
+
+// A flick of the wrist to look at the watch plays the minute animation, once
+// each minute.
+static void accel_tap_handler(AccelAxisType axis, int32_t direction) {
+  struct tm *localNow = getTime(NULL);
+  time_t minute = time(NULL) / 60;
+  if (!_hasFocus || _timeData == NULL || _flickMinute == minute || isQuietHour(localNow->tm_hour)) {
+    return;
+  }
+  
+  _flickMinute = minute;
+  AnimateTimeLayer(_timeData);
+}
+
+// The accelerometer is only kept on for taps while they are wanted.
+static void subscribeTapService() {
+  bool subscribe = (_settings.animateOnFlick != 0);
+  if (subscribe && !_tapSubscribed) {
+    accel_tap_service_subscribe(accel_tap_handler);
+    
+  } else if (!subscribe && _tapSubscribed) {
+    accel_tap_service_unsubscribe();
+  }
+  
+  _tapSubscribed = subscribe;
 }
 
 static void loadSettings(Settings *settings) {
   settings->bluetoothVibrate = readPersistentInt(KEY_BLUETOOTH_VIBRATE, 1);
-  MY_APP_LOG(APP_LOG_LEVEL_INFO, "Load settings: bluetoothVibrate=%i", (int) settings->bluetoothVibrate);
+  settings->animateOnFlick = readPersistentInt(KEY_ANIMATE_ON_FLICK, 0);
+  settings->quietHours = readPersistentInt(KEY_QUIET_HOURS, 0);
+  settings->quietStart = readPersistentInt(KEY_QUIET_START, 23);
+  settings->quietEnd = readPersistentInt(KEY_QUIET_END, 7);
+  settings->quietInterval = readPersistentInt(KEY_QUIET_INTERVAL, 1);
+  settings->reduceAnimationBattery = readPersistentInt(KEY_REDUCE_ANIMATION_BATTERY, 30);
+  settings->stopAnimationBattery = readPersistentInt(KEY_STOP_ANIMATION_BATTERY, 10);
+  MY_APP_LOG(APP_LOG_LEVEL_INFO, "Load settings: bluetoothVibrate=%i animateOnFlick=%i", (int) settings->bluetoothVibrate, (int) settings->animateOnFlick);
+  MY_APP_LOG(APP_LOG_LEVEL_INFO, "Load settings: quietHours=%i quietStart=%i quietEnd=%i quietInterval=%i", (int) settings->quietHours,
+             (int) settings->quietStart, (int) settings->quietEnd, (int) settings->quietInterval);
+  MY_APP_LOG(APP_LOG_LEVEL_INFO, "Load settings: reduceAnimationBattery=%i stopAnimationBattery=%i", (int) settings->reduceAnimationBattery,
+             (int) settings->stopAnimationBattery);
 }
 
 static void saveSettings(Settings *settings) {
   persist_write_int(KEY_BLUETOOTH_VIBRATE, settings->bluetoothVibrate);
+  persist_write_int(KEY_ANIMATE_ON_FLICK, settings->animateOnFlick);
+  persist_write_int(KEY_QUIET_HOURS, settings->quietHours);
+  persist_write_int(KEY_QUIET_START, settings->quietStart);
+  persist_write_int(KEY_QUIET_END, settings->quietEnd);
+  persist_write_int(KEY_QUIET_INTERVAL, settings->quietInterval);
+  persist_write_int(KEY_REDUCE_ANIMATION_BATTERY, settings->reduceAnimationBattery);
+  persist_write_int(KEY_STOP_ANIMATION_BATTERY, settings->stopAnimationBattery);
+}
+
+// Quiet hours run from the start hour up to the end hour, past midnight if
+// the end is earlier in the day.
+static bool isQuietHour(uint16_t hour) {
+  if (!_settings.quietHours) {
+    return false;
+  }
+  
+  if (_settings.quietStart <= _settings.quietEnd) {
+    return (hour >= _settings.quietStart && hour < _settings.quietEnd);
+  }
+  
+  return (hour >= _settings.quietStart || hour < _settings.quietEnd);
 }
 
 static int32_t readPersistentInt(const uint32_t key, int32_t defaultValue) {
@@ -316,12 +488,25 @@ static void fiveMinuteTimerCallback(void *callback_data) {
   sendUsageDuration(5);
 }
 
-static void drawWatchFace(struct tm *tick_time) {
+static void drawWatchFace(struct tm *tick_time, bool minuteTick) {
   uint16_t hour = tick_time->tm_hour;
   uint16_t minute = tick_time->tm_min;
   
   DrawStatusLayer(_statusData, hour, minute);
-  DrawTimeLayer(_timeData, hour, minute);
+  
+  // Quiet hours can leave the time a few minutes behind to save updates.
+  if (minuteTick && isQuietHour(hour) && _settings.quietInterval > 1 && minute % _settings.quietInterval != 0) {
+    return;
+  }
+  
+  // With animation on flicks, or during quiet hours, minutes change straight
+  // to the new time.
+  if (_hasFocus && !_settings.animateOnFlick && !isQuietHour(hour)) {
+    DrawTimeLayer(_timeData, hour, minute);
+    
+  } else {
+    RenderTimeImmediate(_timeData, hour, minute);
+  }
 }
 
 static struct tm* getTime(struct tm *real_time) {
@@ -1,65 +1,130 @@
 #include <pebble.h>
 #include "message_layer.h"
+#include "block_font.h"
 
 #define BORDER_WIDTH 2
 #define TEXT_MARGIN 20
+#define TEXT_PADDING 4
+#define MESSAGE_BLOCK_SIZE 3
+
+// The dotted border's last dots are one pixel past the filled box.
+#define BORDER_BOX_WIDTH (SCREEN_WIDTH - (2 * TEXT_MARGIN) + (2 * BORDER_WIDTH))
+#define BORDER_BOX_HEIGHT (SCREEN_HEIGHT - (2 * TEXT_MARGIN) + (2 * BORDER_WIDTH))
   
 static void borderLayerUpdateProc(Layer *layer, GContext *ctx);
+static void textLayerUpdateProc(Layer *layer, GContext *ctx);
+static void destroyFallbackText(MessageLayerData *data);
 
 MessageLayerData* CreateMessageLayer(Layer *relativeLayer, LayerRelation relation) {
-  MessageLayerData *data = malloc(sizeof(MessageLayerData));
+  MessageLayerData *data = ArenaAlloc(sizeof(MessageLayerData));
   if (data != NULL) {
     memset(data, 0, sizeof(MessageLayerData));
     
-    data->borderLayer = layer_create(GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT));
+    data->borderLayer = layer_create(GRect(TEXT_MARGIN - BORDER_WIDTH, TEXT_MARGIN - BORDER_WIDTH, BORDER_BOX_WIDTH + 1, BORDER_BOX_HEIGHT + 1));
     layer_set_update_proc(data->borderLayer, borderLayerUpdateProc);
     AddLayer(relativeLayer, data->borderLayer, relation);
     
-	  data->textLayer = text_layer_create(GRect(TEXT_MARGIN, TEXT_MARGIN, SCREEN_WIDTH - (2 * TEXT_MARGIN), SCREEN_HEIGHT - (2 * TEXT_MARGIN)));
-  	text_layer_set_font(data->textLayer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
-  	text_layer_set_text_alignment(data->textLayer, GTextAlignmentCenter);
-    AddLayer(relativeLayer, (Layer*) data->textLayer, relation);
+    // The text layer data points back to the message.
+    data->textLayer = layer_create_with_data(GRect(TEXT_MARGIN, TEXT_MARGIN, SCREEN_WIDTH - (2 * TEXT_MARGIN), SCREEN_HEIGHT - (2 * TEXT_MARGIN)), 
+                                             sizeof(MessageLayerData*));
+    *(MessageLayerData**) layer_get_data(data->textLayer) = data;
+    layer_set_update_proc(data->textLayer, textLayerUpdateProc);
+    AddLayer(relativeLayer, data->textLayer, relation);
   }
   
   return data;
 }
 
 void DrawMessageLayer(MessageLayerData *data, const char *text) {
-	text_layer_set_text(data->textLayer, text);  
+  GRect bounds = layer_get_bounds(data->textLayer);
+  
+  data->text = text;
+  data->blockSize = 0;
+  if (BlockTextCanDraw(text)) {
+    data->blockSize = BlockTextFitBlockSize(text, GSize(bounds.size.w - (2 * TEXT_PADDING), bounds.size.h - (2 * TEXT_PADDING)), MESSAGE_BLOCK_SIZE);
+  }
+  
+  // Text the block font can't draw or fit falls back to the Gothic TextLayer
+  // the message used before.
+  if (data->blockSize == 0 && data->fallbackTextLayer == NULL) {
+    data->fallbackTextLayer = text_layer_create(bounds);
+    if (data->fallbackTextLayer != NULL) {
+      text_layer_set_font(data->fallbackTextLayer, fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD));
+      text_layer_set_text_alignment(data->fallbackTextLayer, GTextAlignmentCenter);
+      text_layer_set_background_color(data->fallbackTextLayer, GColorClear);
+      AddLayer(data->textLayer, (Layer*) data->fallbackTextLayer, CHILD);
+    }
+    
+  } else if (data->blockSize != 0) {
+    destroyFallbackText(data);
+  }
+  
+  if (data->fallbackTextLayer != NULL) {
+    text_layer_set_text(data->fallbackTextLayer, text);
+  }
+  
+  layer_mark_dirty(data->textLayer);
 }
 
 void DestroyMessageLayer(MessageLayerData *data) {
   if (data != NULL) {
+    destroyFallbackText(data);
+    
     if (data->textLayer != NULL) {
-      text_layer_destroy(data->textLayer);
+      layer_remove_from_parent(data->textLayer);
+      layer_destroy(data->textLayer);
       data->textLayer = NULL;
     }
     
     if (data->borderLayer != NULL) {
+      layer_remove_from_parent(data->borderLayer);
       layer_destroy(data->borderLayer);
       data->borderLayer = NULL;
     }
     
-    free(data);
+    ArenaFree(data);
   }
 }
 
 static void borderLayerUpdateProc(Layer *layer, GContext *ctx) {
   graphics_context_set_fill_color(ctx, GColorBlack);
 
-  graphics_fill_rect(ctx, GRect(TEXT_MARGIN - BORDER_WIDTH, TEXT_MARGIN - BORDER_WIDTH, 
-                     SCREEN_WIDTH - (2 * TEXT_MARGIN) + (2 * BORDER_WIDTH), 
-                     SCREEN_HEIGHT - (2 * TEXT_MARGIN) + (2 * BORDER_WIDTH)), 0, GCornerNone);
+  graphics_fill_rect(ctx, GRect(0, 0, BORDER_BOX_WIDTH, BORDER_BOX_HEIGHT), 0, GCornerNone);
   
   graphics_context_set_stroke_color(ctx, GColorWhite);
   
-  for (int pixel = TEXT_MARGIN - BORDER_WIDTH; pixel < SCREEN_WIDTH - TEXT_MARGIN + BORDER_WIDTH; pixel += 2) {
-    graphics_draw_pixel(ctx, GPoint(pixel, TEXT_MARGIN - BORDER_WIDTH));
-    graphics_draw_pixel(ctx, GPoint(pixel, SCREEN_HEIGHT - TEXT_MARGIN + BORDER_WIDTH));
+  for (int pixel = 0; pixel < BORDER_BOX_WIDTH; pixel += 2) {
+    graphics_draw_pixel(ctx, GPoint(pixel, 0));
+    graphics_draw_pixel(ctx, GPoint(pixel, BORDER_BOX_HEIGHT));
   }
   
-  for (int pixel = TEXT_MARGIN - BORDER_WIDTH; pixel < SCREEN_HEIGHT - TEXT_MARGIN + BORDER_WIDTH; pixel += 2) {
-    graphics_draw_pixel(ctx, GPoint(TEXT_MARGIN - BORDER_WIDTH, pixel));
-    graphics_draw_pixel(ctx, GPoint(SCREEN_WIDTH - TEXT_MARGIN + BORDER_WIDTH, pixel));
+  for (int pixel = 0; pixel < BORDER_BOX_HEIGHT; pixel += 2) {
+    graphics_draw_pixel(ctx, GPoint(0, pixel));
+    graphics_draw_pixel(ctx, GPoint(BORDER_BOX_WIDTH, pixel));
+  }
+}
+
+// Black block text on white, like the TextLayer this replaced.
+static void textLayerUpdateProc(Layer *layer, GContext *ctx) {
+  MessageLayerData *data = *(MessageLayerData**) layer_get_data(layer);
+  GRect bounds = layer_get_bounds(layer);
+  
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  graphics_fill_rect(ctx, bounds, 0, GCornerNone);
+  
+  if (data->text == NULL || data->blockSize == 0) {
+    return;
+  }
+  
+  graphics_context_set_fill_color(ctx, GColorBlack);
+  DrawBlockText(ctx, data->text, GRect(TEXT_PADDING, TEXT_PADDING, bounds.size.w - (2 * TEXT_PADDING), bounds.size.h - (2 * TEXT_PADDING)), 
+                data->blockSize, GTextAlignmentCenter);
+}
+
+static void destroyFallbackText(MessageLayerData *data) {
+  if (data->fallbackTextLayer != NULL) {
+    layer_remove_from_parent((Layer*) data->fallbackTextLayer);
+    text_layer_destroy(data->fallbackTextLayer);
+    data->fallbackTextLayer = NULL;
   }
 }
@@ -3,7 +3,10 @@
 
 typedef struct {
   Layer *borderLayer;
-  TextLayer *textLayer;
+  Layer *textLayer;
+  TextLayer *fallbackTextLayer;   // Only for text the block font can't fit
+  const char *text;
+  uint8_t blockSize;              // 0 when the fallback TextLayer shows the text
 } MessageLayerData;
 
 MessageLayerData* CreateMessageLayer(Layer *relativeLayer, LayerRelation relation);
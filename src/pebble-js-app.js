@@ -1,4 +1,4 @@
-var INSTALLED_SETTINGS_VERSION = 1;
+var INSTALLED_SETTINGS_VERSION = 4;
 var CONSOLE_LOG = false;
 
 Pebble.addEventListener("ready",
@@ -42,7 +42,14 @@ Pebble.addEventListener("webviewclosed",
       saveSettings(configuration);
 
       var dictionary = {
-        "KEY_BLUETOOTH_VIBRATE" : parseInt(configuration.bluetoothVibrate)
+        "KEY_BLUETOOTH_VIBRATE" : parseInt(configuration.bluetoothVibrate),
+        "KEY_ANIMATE_ON_FLICK" : parseInt(configuration.animateOnFlick),
+        "KEY_QUIET_HOURS" : parseInt(configuration.quietHours),
+        "KEY_QUIET_START" : parseInt(configuration.quietStart),
+        "KEY_QUIET_END" : parseInt(configuration.quietEnd),
+        "KEY_QUIET_INTERVAL" : parseInt(configuration.quietInterval),
+        "KEY_REDUCE_ANIMATION_BATTERY" : parseInt(configuration.reduceAnimationBattery),
+        "KEY_STOP_ANIMATION_BATTERY" : parseInt(configuration.stopAnimationBattery)
       };
   
       Pebble.sendAppMessage(dictionary,
@@ -59,13 +66,30 @@ Pebble.addEventListener("webviewclosed",
 
 function formatUrlVariables() {
   var bluetoothVibrate = getLocalInt("bluetoothVibrate", 1);
+  var animateOnFlick = getLocalInt("animateOnFlick", 0);
+  var quietHours = getLocalInt("quietHours", 0);
+  var quietStart = getLocalInt("quietStart", 23);
+  var quietEnd = getLocalInt("quietEnd", 7);
+  var quietInterval = getLocalInt("quietInterval", 1);
+  var reduceAnimationBattery = getLocalInt("reduceAnimationBattery", 30);
+  var stopAnimationBattery = getLocalInt("stopAnimationBattery", 10);
   
   return ("installedSettingsVersion=" + INSTALLED_SETTINGS_VERSION + "&bluetoothVibrate=" + bluetoothVibrate +
+          "&animateOnFlick=" + animateOnFlick + "&quietHours=" + quietHours + "&quietStart=" + quietStart +
+          "&quietEnd=" + quietEnd + "&quietInterval=" + quietInterval +
+          "&reduceAnimationBattery=" + reduceAnimationBattery + "&stopAnimationBattery=" + stopAnimationBattery +
           "&accountToken=" + Pebble.getAccountToken() + "&watchToken=" + Pebble.getWatchToken());
 }
 
 function saveSettings(settings) {
   localStorage.setItem("bluetoothVibrate", parseInt(settings.bluetoothVibrate)); 
+  localStorage.setItem("animateOnFlick", parseInt(settings.animateOnFlick));
+  localStorage.setItem("quietHours", parseInt(settings.quietHours));
+  localStorage.setItem("quietStart", parseInt(settings.quietStart));
+  localStorage.setItem("quietEnd", parseInt(settings.quietEnd));
+  localStorage.setItem("quietInterval", parseInt(settings.quietInterval));
+  localStorage.setItem("reduceAnimationBattery", parseInt(settings.reduceAnimationBattery));
+  localStorage.setItem("stopAnimationBattery", parseInt(settings.stopAnimationBattery));
 }
 
 function recordUsageDuration(duration) {
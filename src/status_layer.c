@@ -1,31 +1,39 @@
 #include <pebble.h>
 #include "status_layer.h"
+#include "block_font.h"
+
+#define STATUS_BLOCK_SIZE 2
   
 static char _batteryText[20];
 static char _bluetoothConnected[] = "Connected";
 static char _bluetoothDisconnected[50];
+static const char *_bluetoothText = NULL;
+
+// Block sizes the text is drawn at, 0 when it's left to the fallback TextLayer
+static uint8_t _batteryBlockSize = 0;
+static uint8_t _bluetoothBlockSize = 0;
 
 static void setDisconnectedString();
 static void setPercentage(uint8_t chargePercent);
+static void batteryLayerUpdateProc(Layer *layer, GContext *ctx);
+static void bluetoothLayerUpdateProc(Layer *layer, GContext *ctx);
+static void drawStatusText(GContext *ctx, GRect bounds, const char *text, uint8_t blockSize, GTextAlignment alignment);
+static uint8_t getStatusBlockSize(Layer *layer, const char *text);
+static TextLayer* updateFallbackText(TextLayer *textLayer, Layer *layer, const char *text, GTextAlignment alignment);
   
 StatusLayerData* CreateStatusLayer(Layer *relativeLayer, LayerRelation relation) {
-  StatusLayerData *data = malloc(sizeof(StatusLayerData));
+  StatusLayerData *data = ArenaAlloc(sizeof(StatusLayerData));
   if (data != NULL) {
     memset(data, 0, sizeof(StatusLayerData));
     
-    data->textLayerBattery = text_layer_create(GRect(107, SCREEN_HEIGHT - 18, 33, 18));
-  	text_layer_set_font(data->textLayerBattery, fonts_get_system_font(FONT_KEY_GOTHIC_14));
-  	text_layer_set_text_alignment(data->textLayerBattery, GTextAlignmentRight);
-    text_layer_set_text_color(data->textLayerBattery, GColorWhite);
-    text_layer_set_background_color(data->textLayerBattery, GColorClear);
-    AddLayer(relativeLayer, (Layer*) data->textLayerBattery, relation);
+    // Wide enough for "100 %" at STATUS_BLOCK_SIZE
+    data->batteryLayer = layer_create(GRect(106, SCREEN_HEIGHT - 18, 34, 18));
+    layer_set_update_proc(data->batteryLayer, batteryLayerUpdateProc);
+    AddLayer(relativeLayer, data->batteryLayer, relation);
     
-    data->textLayerBluetooth = text_layer_create(GRect(3, SCREEN_HEIGHT - 18, 104, 18));
-   	text_layer_set_font(data->textLayerBluetooth, fonts_get_system_font(FONT_KEY_GOTHIC_14));
-  	text_layer_set_text_alignment(data->textLayerBluetooth, GTextAlignmentLeft);
-    text_layer_set_text_color(data->textLayerBluetooth, GColorWhite);
-    text_layer_set_background_color(data->textLayerBluetooth, GColorClear);
-    AddLayer(relativeLayer, (Layer*) data->textLayerBluetooth, relation);
+    data->bluetoothLayer = layer_create(GRect(3, SCREEN_HEIGHT - 18, 103, 18));
+    layer_set_update_proc(data->bluetoothLayer, bluetoothLayerUpdateProc);
+    AddLayer(relativeLayer, data->bluetoothLayer, relation);
   }
   
   return data;
@@ -37,27 +45,35 @@ void DrawStatusLayer(StatusLayerData *data, uint16_t hour, uint16_t minute) {
 
 void DestroyStatusLayer(StatusLayerData *data) {
   if (data != NULL) {
-    if (data->textLayerBattery != NULL) {
-      text_layer_destroy(data->textLayerBattery);
-      data->textLayerBattery = NULL;
+    data->textLayerBattery = updateFallbackText(data->textLayerBattery, data->batteryLayer, NULL, GTextAlignmentRight);
+    data->textLayerBluetooth = updateFallbackText(data->textLayerBluetooth, data->bluetoothLayer, NULL, GTextAlignmentLeft);
+    
+    if (data->bluetoothLayer != NULL) {
+      layer_remove_from_parent(data->bluetoothLayer);
+      layer_destroy(data->bluetoothLayer);
+      data->bluetoothLayer = NULL;
     }
     
-    if (data->textLayerBluetooth != NULL) {
-      text_layer_destroy(data->textLayerBluetooth);
-      data->textLayerBluetooth = NULL;
+    if (data->batteryLayer != NULL) {
+      layer_remove_from_parent(data->batteryLayer);
+      layer_destroy(data->batteryLayer);
+      data->batteryLayer = NULL;
     }
     
-    free(data);
+    ArenaFree(data);
   }
 }
 
 void UpdateBatteryStatus(StatusLayerData *data, BatteryChargeState charge_state) {
   setPercentage(charge_state.charge_percent);
-  text_layer_set_text(data->textLayerBattery, _batteryText);
+  _batteryBlockSize = getStatusBlockSize(data->batteryLayer, _batteryText);
+  data->textLayerBattery = updateFallbackText(data->textLayerBattery, data->batteryLayer, ((_batteryBlockSize == 0) ? _batteryText : NULL), 
+                                              GTextAlignmentRight);
+  layer_mark_dirty(data->batteryLayer);
 }
 
 void ShowBatteryStatus(StatusLayerData *data, bool show) {
-  layer_set_hidden((Layer*) data->textLayerBattery, (show == false));
+  layer_set_hidden(data->batteryLayer, (show == false));
 }
 
 void UpdateBluetoothStatus(StatusLayerData *data, bool connected) {
@@ -65,11 +81,81 @@ void UpdateBluetoothStatus(StatusLayerData *data, bool connected) {
     setDisconnectedString();
   }
   
-  text_layer_set_text(data->textLayerBluetooth, connected ? _bluetoothConnected : _bluetoothDisconnected);  
+  _bluetoothText = connected ? _bluetoothConnected : _bluetoothDisconnected;
+  _bluetoothBlockSize = getStatusBlockSize(data->bluetoothLayer, _bluetoothText);
+  data->textLayerBluetooth = updateFallbackText(data->textLayerBluetooth, data->bluetoothLayer, ((_bluetoothBlockSize == 0) ? _bluetoothText : NULL),
+                                                GTextAlignmentLeft);
+  layer_mark_dirty(data->bluetoothLayer);
 }
 
 void ShowBluetoothStatus(StatusLayerData *data, bool show) {
-  layer_set_hidden((Layer*) data->textLayerBluetooth, (show == false));
+  layer_set_hidden(data->bluetoothLayer, (show == false));
+}
+
+static void batteryLayerUpdateProc(Layer *layer, GContext *ctx) {
+  drawStatusText(ctx, layer_get_bounds(layer), _batteryText, _batteryBlockSize, GTextAlignmentRight);
+}
+
+static void bluetoothLayerUpdateProc(Layer *layer, GContext *ctx) {
+  drawStatusText(ctx, layer_get_bounds(layer), _bluetoothText, _bluetoothBlockSize, GTextAlignmentLeft);
+}
+
+// Draws the text in white, centered vertically. Text left to the fallback
+// TextLayer, a child of the layer, draws itself.
+static void drawStatusText(GContext *ctx, GRect bounds, const char *text, uint8_t blockSize, GTextAlignment alignment) {
+  if (text == NULL || blockSize == 0) {
+    return;
+  }
+  
+  int16_t height = BlockTextHeight(text, bounds.size.w, blockSize);
+  if (height > 0) {
+    bounds.origin.y += (bounds.size.h - height) / 2;
+  }
+  
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  DrawBlockText(ctx, text, bounds, blockSize, alignment);
+}
+
+// Returns the block size the text fits the layer at, or 0 for text the block
+// font can't draw there, like the Chinese string. Text that only fits in
+// smaller blocks than STATUS_BLOCK_SIZE, like the German string, is too small
+// to read and gets 0 too.
+static uint8_t getStatusBlockSize(Layer *layer, const char *text) {
+  if (!BlockTextCanDraw(text)) {
+    return 0;
+  }
+  
+  uint8_t blockSize = BlockTextFitBlockSize(text, layer_get_bounds(layer).size, STATUS_BLOCK_SIZE);
+  return (blockSize == STATUS_BLOCK_SIZE) ? blockSize : 0;
+}
+
+// Shows the text in a Gothic TextLayer over the layer, creating it if needed.
+// A NULL text destroys the TextLayer. Returns the TextLayer, or NULL.
+static TextLayer* updateFallbackText(TextLayer *textLayer, Layer *layer, const char *text, GTextAlignment alignment) {
+  if (text == NULL) {
+    if (textLayer != NULL) {
+      layer_remove_from_parent((Layer*) textLayer);
+      text_layer_destroy(textLayer);
+    }
+    
+    return NULL;
+  }
+  
+  if (textLayer == NULL) {
+    textLayer = text_layer_create(layer_get_bounds(layer));
+    if (textLayer == NULL) {
+      return NULL;
+    }
+    
+    text_layer_set_font(textLayer, fonts_get_system_font(FONT_KEY_GOTHIC_14));
+    text_layer_set_text_alignment(textLayer, alignment);
+    text_layer_set_text_color(textLayer, GColorWhite);
+    text_layer_set_background_color(textLayer, GColorClear);
+    AddLayer(layer, (Layer*) textLayer, CHILD);
+  }
+  
+  text_layer_set_text(textLayer, text);
+  return textLayer;
 }
 
 static void setDisconnectedString() {
@@ -2,8 +2,10 @@
 #include "common.h"
 
 typedef struct {
+  Layer *batteryLayer;
+  Layer *bluetoothLayer;
+  TextLayer *textLayerBattery;      // Only for text the block font can't draw
   TextLayer *textLayerBluetooth;
-  TextLayer *textLayerBattery;
 } StatusLayerData;
 
 StatusLayerData* CreateStatusLayer(Layer *relativeLayer, LayerRelation relation);
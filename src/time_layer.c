@@ -1,39 +1,99 @@
 #include <pebble.h>
 #include "time_layer.h"
   
-typedef enum { TS_WIPER, TS_DIGITS, TS_COLON_TOP, TS_COLON_BOTTOM, TS_AMPM } TimeState;
+typedef void (*TimeStageStart)(TimeLayerData *data);
+typedef bool (*TimeStageSkip)(TimeLayerData *data);
+
+// One stage of the minute animation. A stage starts offset milliseconds after
+// the stage it follows started or finished, or after the animation started, so
+// stages can overlap. It finishes as soon as it has started, or for untilDone
+// stages when it calls timeStageDone. A skipped stage starts and finishes at
+// once, so the stages following it still run.
+typedef struct {
+  int8_t after;             // Stage this one follows, or ANIMATION_START
+  bool afterStart;          // Follow the start of that stage rather than its finish
+  uint16_t offset;
+  bool untilDone;
+  TimeStageSkip skip;       // Optional, whether to leave the stage out this minute
+  TimeStageStart start;
+} TimeStage;
 
 #define COLON_DRAW_DURATION 350
+#define ANIMATION_START -1
+#define WIPER_STAGE 0
+#define DIGITS_STAGE 1
+#define COLON_TOP_STAGE 2
+#define COLON_BOTTOM_STAGE 3
+#define AM_PM_STAGE 4
+#define NUM_TIME_STAGES 5
+#define ALL_TIME_STAGES ((1 << NUM_TIME_STAGES) - 1)
+#define STAGE_BIT(stageIndex) (1 << (stageIndex))
   
-static GRect _colonTop = { {69, 73}, {6, 6} };
-static GRect _colonBottom = { {69, 89}, {6, 6} };
+static GRect _colonTop = { {0, 0}, {6, 6} };
+static GRect _colonBottom = { {0, 16}, {6, 6} };
+static GRect _colonFrame = { {69, 73}, {6, 22} };
 static GRect _amPm = { {18, 43}, {14, 9} };
 
 static int16_t _digits[4];
-static AppTimer *_timeTimer = NULL;
+static TimeLayerData *_stageData = NULL;
+static AppTimer *_stageTimers[NUM_TIME_STAGES];
+static uint8_t _stagesStarted = ALL_TIME_STAGES;
+static uint8_t _stagesDone = ALL_TIME_STAGES;
 static bool _drawColonTop = false;
 static bool _drawColonBottom = false;
-static TimeState _timeState;
+static bool _changedDigitsOnly = false;
+static int16_t _digitsMorphing = 0;
   
 static uint16_t getHour(uint16_t hour);
-static void timeTimerCallback(void *callback_data);
-static void timeLayerUpdateProc(Layer *layer, GContext *ctx);
+static bool setDigits(TimeLayerData *data, uint16_t hour, uint16_t minute);
+static void showTime(TimeLayerData *data);
+static void stageTimerCallback(void *callback_data);
+static void cancelStageTimers();
+static void colonLayerUpdateProc(Layer *layer, GContext *ctx);
 static void wiperFinishedCallback(void *callback_data);
 static void digitFinishedCallback(void *callback_data);
-static void moveToNextTimeState();
+static void digitMorphedCallback(void *callback_data);
+static void startTimeStages(TimeLayerData *data);
+static void followTimeStage(TimeLayerData *data, int8_t after, bool afterStart);
+static void scheduleTimeStage(TimeLayerData *data, int8_t stageIndex);
+static void startTimeStage(TimeLayerData *data, int8_t stageIndex);
+static void timeStageDone(TimeLayerData *data, int8_t stageIndex);
+static void startWiper(TimeLayerData *data);
+static void startDigits(TimeLayerData *data);
+static void startColonTop(TimeLayerData *data);
+static void startColonBottom(TimeLayerData *data);
+static void startAmPm(TimeLayerData *data);
+static bool skipColon(TimeLayerData *data);
+static bool skipAmPm(TimeLayerData *data);
+static void continueTime(TimeLayerData *data);
 static void clearTime(TimeLayerData *data);
+static bool timeIsSettled();
+
+// The minute animation, indexed by the *_STAGE values. The colon is drawn in
+// while the digits are still being built, and AM/PM follows once they're done.
+static const TimeStage _timeline[NUM_TIME_STAGES] = {
+  { ANIMATION_START, false, 0, true, NULL, startWiper },
+  { WIPER_STAGE, false, 0, true, NULL, startDigits },
+  { DIGITS_STAGE, true, 2 * COLON_DRAW_DURATION, false, skipColon, startColonTop },
+  { COLON_TOP_STAGE, false, COLON_DRAW_DURATION, false, skipColon, startColonBottom },
+  { DIGITS_STAGE, false, COLON_DRAW_DURATION, false, skipAmPm, startAmPm }
+};
 
 TimeLayerData* CreateTimeLayer(Layer *relativeLayer, LayerRelation relation) {
-  TimeLayerData* data = malloc(sizeof(TimeLayerData));
+  TimeLayerData* data = ArenaAlloc(sizeof(TimeLayerData));
   if (data != NULL) {
     memset(data, 0, sizeof(TimeLayerData));
     data->lastUpdateMinute = -1;
     
-    // Layer for drawing colon.
+    // Screen sized parent of the time layers. It draws nothing itself, so the
+    // colon has a layer of its own under everything else.
     data->layer = layer_create(GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT));
-    layer_set_update_proc(data->layer, timeLayerUpdateProc);
     AddLayer(relativeLayer, data->layer, relation);
     
+    data->colonLayer = layer_create(_colonFrame);
+    layer_set_update_proc(data->colonLayer, colonLayerUpdateProc);
+    AddLayer(data->layer, data->colonLayer, CHILD);
+    
     // Digit layers
     data->digitData[0] = CreateDigitLayer(data->layer, CHILD, GPoint(5, 62));
     data->digitData[1] = CreateDigitLayer(data->layer, CHILD, GPoint(37, 62));
@@ -41,10 +101,12 @@ TimeLayerData* CreateTimeLayer(Layer *relativeLayer, LayerRelation relation) {
     data->digitData[3] = CreateDigitLayer(data->layer, CHILD, GPoint(112, 62));
     
     // AM/PM layer
-    CreateRotBitmapGroup(&data->amPm.group, data->layer, CHILD, NULL, RESOURCE_ID_IMAGE_AM, GCompOpAssign);
-    layer_set_hidden((Layer*) data->amPm.group.layer, true);
+    data->amPmBitmaps[0] = AcquireBitmap(RESOURCE_ID_IMAGE_AM);
+    data->amPmBitmaps[1] = AcquireBitmap(RESOURCE_ID_IMAGE_PM);
+    CreateRotBitmapGroup(&data->amPm.group, data->layer, CHILD, RESOURCE_ID_IMAGE_AM, GCompOpAssign);
+    layer_set_hidden(RotBitmapGroupGetLayer(&data->amPm.group), true);
     GRect ampmFrame = RotRectFromBitmapRect(&data->amPm.group, _amPm);
-    layer_set_frame((Layer*) data->amPm.group.layer, ampmFrame);
+    layer_set_frame(RotBitmapGroupGetLayer(&data->amPm.group), ampmFrame);
     
     // Wiper layer
     GRect wipeRect = { {0, _amPm.origin.y}, {SCREEN_WIDTH, (107 - _amPm.origin.y)} };
@@ -55,16 +117,16 @@ TimeLayerData* CreateTimeLayer(Layer *relativeLayer, LayerRelation relation) {
 }
 
 void DestroyTimeLayer(TimeLayerData *data) {
-  if (_timeTimer != NULL) {
-    app_timer_cancel(_timeTimer);
-    _timeTimer = NULL;
-  }
+  cancelStageTimers();
+  _stageData = NULL;
   
   if (data != NULL) {
     DestroyWiperLayer(data->wiperData);
     data->wiperData = NULL;
       
     DestroyRotBitmapGroup(&data->amPm.group);
+    ReleaseBitmap(data->amPmBitmaps[0]);
+    ReleaseBitmap(data->amPmBitmaps[1]);
     
     DestroyDigitLayer(data->digitData[0]);
     data->digitData[0] = NULL;
@@ -78,13 +140,19 @@ void DestroyTimeLayer(TimeLayerData *data) {
     DestroyDigitLayer(data->digitData[3]);
     data->digitData[3] = NULL;
     
+    if (data->colonLayer != NULL) {
+      layer_remove_from_parent(data->colonLayer);
+      layer_destroy(data->colonLayer);
+      data->colonLayer = NULL;
+    }
+    
     if (data->layer != NULL) {
       layer_remove_from_parent(data->layer);
       layer_destroy(data->layer);
       data->layer = NULL;
     }
     
-    free(data);
+    ArenaFree(data);
   }
 }
 
@@ -94,20 +162,65 @@ void DrawTimeLayer(TimeLayerData *data, uint16_t hour, uint16_t minute) {
     return;
   }
   
-  // Remember whether first time called.
-  bool firstDisplay = (data->lastUpdateMinute == -1); 
+  // The first time is shown straight away as there's nothing on screen to
+  // wipe, and so is every time with the animation off.
+  if (data->lastUpdateMinute == -1 || data->animation == TIME_ANIMATION_NONE) {
+    RenderTimeImmediate(data, hour, minute);
+    return;
+  }
+  
   data->lastUpdateMinute = minute;
+  bool settled = timeIsSettled();
+  bool amPmChanged = setDigits(data, hour, minute);
+  
+  // If the time changes while still animating, the animation carries on to the
+  // new time. An AM/PM change can't be carried on, so the new time is shown as
+  // it is.
+  if (!settled) {
+    if (amPmChanged) {
+      showTime(data);
+      
+    } else {
+      continueTime(data);
+    }
+    
+    return;
+  }
   
-  // If time change occurs while still animating, cancel previous animation and
-  // start over with current time.
-  bool interruptedTimer = false;
-  if (_timeTimer != NULL) {
-    app_timer_cancel(_timeTimer);
-    _timeTimer = NULL;
-    interruptedTimer = true;
-    clearTime(data);
+  // Unless the whole time has to be redrawn, only the digits that changed are
+  // rebuilt after the wipe. The hour digits usually stay put.
+  _changedDigitsOnly = !amPmChanged;
+  startTimeStages(data);
+}
+
+// Plays the minute animation again over the time on screen, wiping it and
+// building it back up. Does nothing while the time is still animating.
+void AnimateTimeLayer(TimeLayerData *data) {
+  if (data->lastUpdateMinute == -1 || data->animation == TIME_ANIMATION_NONE || !timeIsSettled()) {
+    return;
   }
   
+  _changedDigitsOnly = false;
+  startTimeStages(data);
+}
+
+// Takes effect from the next animation, one already running plays out.
+void SetTimeAnimation(TimeLayerData *data, TimeAnimation animation) {
+  data->animation = animation;
+}
+
+// Shows the time fully drawn in a single frame, stopping any animation.
+void RenderTimeImmediate(TimeLayerData *data, uint16_t hour, uint16_t minute) {
+  data->lastUpdateMinute = minute;
+  setDigits(data, hour, minute);
+  showTime(data);
+}
+
+// Sets _digits to the time, and the AM/PM bitmap to match. Returns whether
+// AM/PM changed.
+static bool setDigits(TimeLayerData *data, uint16_t hour, uint16_t minute) {
+  bool amPmChanged = false;
+  
   uint16_t trueHour = getHour(hour);
   if (clock_is_24h_style() == true) {
     _digits[0] = trueHour / 10;
@@ -123,23 +236,77 @@ void DrawTimeLayer(TimeLayerData *data, uint16_t hour, uint16_t minute) {
       _digits[1] = trueHour % 10;
     }
     
+    // AM/PM is shown last, so a change redraws everything.
     if (hour < 12 && data->amPm.group.resourceId != RESOURCE_ID_IMAGE_AM) {
-      RotBitmapGroupChangeBitmap(&data->amPm.group, NULL, RESOURCE_ID_IMAGE_AM);
+      RotBitmapGroupChangeBitmap(&data->amPm.group, RESOURCE_ID_IMAGE_AM);
+      amPmChanged = true;
       
     } else if (hour > 11 && data->amPm.group.resourceId != RESOURCE_ID_IMAGE_PM) {
-      RotBitmapGroupChangeBitmap(&data->amPm.group, NULL, RESOURCE_ID_IMAGE_PM);
+      RotBitmapGroupChangeBitmap(&data->amPm.group, RESOURCE_ID_IMAGE_PM);
+      amPmChanged = true;
     }
   }
   
   _digits[2] = minute / 10;
   _digits[3] = minute % 10;
+  return amPmChanged;
+}
 
-  _timeState = TS_WIPER;
-  if (firstDisplay || interruptedTimer) {
-    _timeTimer = app_timer_register((firstDisplay ? FIRST_DISPLAY_ANIMATION_DELAY : 10), timeTimerCallback, (void*) data);
-    
-  } else {
-    RunWiper(data->wiperData, wiperFinishedCallback, (void*) data);
+// Puts _digits, colon and AM/PM on screen as the end of the animation leaves
+// them. Callbacks still due from the animation are dropped with their timers.
+static void showTime(TimeLayerData *data) {
+  cancelStageTimers();
+  
+  ClearWiper(data->wiperData);
+  for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+    ShowDigit(data->digitData[digitIndex], _digits[digitIndex]);
+  }
+  
+  if (!_drawColonTop || !_drawColonBottom) {
+    _drawColonTop = true;
+    _drawColonBottom = true;
+    layer_mark_dirty(data->colonLayer);
+  }
+  
+  layer_set_hidden(RotBitmapGroupGetLayer(&data->amPm.group), clock_is_24h_style());
+  
+  _stagesStarted = ALL_TIME_STAGES;
+  _stagesDone = ALL_TIME_STAGES;
+}
+
+// Points the running animation at the new _digits. Before the digits stage
+// nothing needs doing, as it builds whatever _digits hold when it starts.
+// Digits being built, or already built while the colon is still to come,
+// morph from whatever they show to the new digit.
+static void continueTime(TimeLayerData *data) {
+  if (!(_stagesStarted & STAGE_BIT(DIGITS_STAGE))) {
+    return;
+  }
+  
+  bool digitsRunning = !(_stagesDone & STAGE_BIT(DIGITS_STAGE));
+  bool retarget[4];
+  int16_t digitsMorphing = 0;
+  for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+    DigitLayerData *digitData = data->digitData[digitIndex];
+    retarget[digitIndex] = (digitData->digit != _digits[digitIndex] || (digitsRunning && digitData->spotTimer != NULL));
+    if (retarget[digitIndex]) {
+      digitsMorphing++;
+    }
+  }
+  
+  // The digits stage finishes with the last digit it is still waiting for.
+  if (digitsRunning) {
+    _digitsMorphing = digitsMorphing;
+    if (digitsMorphing == 0) {
+      digitFinishedCallback(data);
+      return;
+    }
+  }
+  
+  for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+    if (retarget[digitIndex]) {
+      MorphDigit(data->digitData[digitIndex], _digits[digitIndex], (digitsRunning ? digitMorphedCallback : NULL), data);
+    }
   }
 }
 
@@ -150,78 +317,171 @@ static void clearTime(TimeLayerData *data) {
   DeconstructDigit(data->digitData[3], NULL, NULL);
   _drawColonTop = false;
   _drawColonBottom = false;
-  layer_set_hidden((Layer*) data->amPm.group.layer, true);
+  layer_set_hidden(RotBitmapGroupGetLayer(&data->amPm.group), true);
   ClearWiper(data->wiperData);
 }
 
 static void wiperFinishedCallback(void *callback_data) {
-  moveToNextTimeState((TimeLayerData*) callback_data);
+  timeStageDone((TimeLayerData*) callback_data, WIPER_STAGE);
 }
 
 static void digitFinishedCallback(void *callback_data) {
-  _timeTimer = app_timer_register(COLON_DRAW_DURATION, timeTimerCallback, callback_data);
+  timeStageDone((TimeLayerData*) callback_data, DIGITS_STAGE);
 }
 
-static void timeTimerCallback(void *callback_data) {
-  _timeTimer = NULL;
-  moveToNextTimeState((TimeLayerData*) callback_data);
+// Digits morph for different lengths of time, so wait for the last one.
+static void digitMorphedCallback(void *callback_data) {
+  _digitsMorphing--;
+  if (_digitsMorphing == 0) {
+    digitFinishedCallback(callback_data);
+  }
 }
 
-static void moveToNextTimeState(TimeLayerData *data) {
-  switch (_timeState) {
-    case TS_WIPER:
-      _timeState = TS_DIGITS;
+// The stage index rides in the callback data, the layer data is kept aside.
+static void stageTimerCallback(void *callback_data) {
+  int8_t stageIndex = (int8_t) (intptr_t) callback_data;
+  _stageTimers[stageIndex] = NULL;
+  startTimeStage(_stageData, stageIndex);
+}
 
-      clearTime(data);
+static void cancelStageTimers() {
+  for (int stageIndex = 0; stageIndex < NUM_TIME_STAGES; stageIndex++) {
+    if (_stageTimers[stageIndex] != NULL) {
+      app_timer_cancel(_stageTimers[stageIndex]);
+      _stageTimers[stageIndex] = NULL;
+    }
+  }
+}
 
-      bool setCallback = false;
-      for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
-        if (_digits[digitIndex] != -1) {
-          if (setCallback) {
-            ConstructDigit(data->digitData[digitIndex], _digits[digitIndex], NULL, NULL);
-            
-          } else {
-            ConstructDigit(data->digitData[digitIndex], _digits[digitIndex], digitFinishedCallback, data);
-            setCallback = true;
-          }
-        }
-      }
-    
-      break;
+// Runs the animation from the top. The time must be settled, so no stage is
+// still running or waiting.
+static void startTimeStages(TimeLayerData *data) {
+  _stageData = data;
+  _stagesStarted = 0;
+  _stagesDone = 0;
+  followTimeStage(data, ANIMATION_START, false);
+}
+
+// Schedules every stage that follows the start or finish of the given stage.
+static void followTimeStage(TimeLayerData *data, int8_t after, bool afterStart) {
+  for (int8_t stageIndex = 0; stageIndex < NUM_TIME_STAGES; stageIndex++) {
+    const TimeStage *stage = &_timeline[stageIndex];
+    if (stage->after == after && stage->afterStart == afterStart) {
+      scheduleTimeStage(data, stageIndex);
+    }
+  }
+}
+
+static void scheduleTimeStage(TimeLayerData *data, int8_t stageIndex) {
+  const TimeStage *stage = &_timeline[stageIndex];
+  if (stage->skip != NULL && stage->skip(data)) {
+    _stagesStarted |= STAGE_BIT(stageIndex);
+    followTimeStage(data, stageIndex, true);
+    _stagesDone |= STAGE_BIT(stageIndex);
+    followTimeStage(data, stageIndex, false);
     
-    case TS_DIGITS:
-      _timeState = TS_COLON_TOP;
+  } else if (stage->offset > 0) {
+    _stageTimers[stageIndex] = app_timer_register(stage->offset, stageTimerCallback, (void*) (intptr_t) stageIndex);
     
-      _drawColonTop = true;
-      layer_mark_dirty(data->layer);
+  } else {
+    startTimeStage(data, stageIndex);
+  }
+}
+
+// Stages that follow this one's start are scheduled before it starts, so they
+// still come first if it finishes straight away.
+static void startTimeStage(TimeLayerData *data, int8_t stageIndex) {
+  const TimeStage *stage = &_timeline[stageIndex];
+  _stagesStarted |= STAGE_BIT(stageIndex);
+  followTimeStage(data, stageIndex, true);
+  stage->start(data);
+  if (!stage->untilDone) {
+    timeStageDone(data, stageIndex);
+  }
+}
+
+// Only a running stage can finish, so a callback left from a stage that was cut
+// short does nothing.
+static void timeStageDone(TimeLayerData *data, int8_t stageIndex) {
+  if (!(_stagesStarted & STAGE_BIT(stageIndex)) || (_stagesDone & STAGE_BIT(stageIndex))) {
+    return;
+  }
+  
+  _stagesDone |= STAGE_BIT(stageIndex);
+  followTimeStage(data, stageIndex, false);
+}
+
+static void startWiper(TimeLayerData *data) {
+  RunWiper(data->wiperData, ((data->animation == TIME_ANIMATION_REDUCED) ? 1 : NUM_SHADES), wiperFinishedCallback, (void*) data);
+}
+
+static void startDigits(TimeLayerData *data) {
+  if (_changedDigitsOnly) {
+    // Changed digits morph straight from the old digit to the new one.
+    ClearWiper(data->wiperData);
     
-      _timeTimer = app_timer_register(COLON_DRAW_DURATION, timeTimerCallback, (void*) data);
-      break;
+    _digitsMorphing = 0;
+    for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+      if (data->digitData[digitIndex]->digit != _digits[digitIndex]) {
+        _digitsMorphing++;
+      }
+    }
     
-    case TS_COLON_TOP:
-      _timeState = TS_COLON_BOTTOM;
+    if (_digitsMorphing == 0) {
+      digitFinishedCallback(data);
+      return;
+    }
     
-      _drawColonBottom = true;
-      layer_mark_dirty(data->layer);
+    for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+      if (data->digitData[digitIndex]->digit != _digits[digitIndex]) {
+        MorphDigit(data->digitData[digitIndex], _digits[digitIndex], digitMorphedCallback, data);
+      }
+    }
     
-      if (clock_is_24h_style() == false) {
-        _timeTimer = app_timer_register(COLON_DRAW_DURATION, timeTimerCallback, (void*) data);
+    return;
+  }
+  
+  clearTime(data);
+
+  bool setCallback = false;
+  for (int digitIndex = 0; digitIndex < 4; digitIndex++) {
+    if (_digits[digitIndex] != -1) {
+      if (setCallback) {
+        ConstructDigit(data->digitData[digitIndex], _digits[digitIndex], NULL, NULL);
+        
+      } else {
+        ConstructDigit(data->digitData[digitIndex], _digits[digitIndex], digitFinishedCallback, data);
+        setCallback = true;
       }
+    }
+  }
+}
 
-      break;
-    
-    case TS_COLON_BOTTOM:
-      _timeState = TS_AMPM;
-    
-      layer_set_hidden((Layer*) data->amPm.group.layer, false);
-      break;
-    
-    default:
-      break;
-  }  
+static void startColonTop(TimeLayerData *data) {
+  _drawColonTop = true;
+  layer_mark_dirty(data->colonLayer);
+}
+
+static void startColonBottom(TimeLayerData *data) {
+  _drawColonBottom = true;
+  layer_mark_dirty(data->colonLayer);
+}
+
+static void startAmPm(TimeLayerData *data) {
+  layer_set_hidden(RotBitmapGroupGetLayer(&data->amPm.group), false);
 }
 
-static void timeLayerUpdateProc(Layer *layer, GContext *ctx) {
+// Colon and AM/PM are still showing from the last minute when only the
+// changed digits are rebuilt.
+static bool skipColon(TimeLayerData *data) {
+  return _changedDigitsOnly;
+}
+
+static bool skipAmPm(TimeLayerData *data) {
+  return (_changedDigitsOnly || clock_is_24h_style());
+}
+
+static void colonLayerUpdateProc(Layer *layer, GContext *ctx) {
   if (_drawColonTop) {
     graphics_context_set_fill_color(ctx, GColorWhite);
     graphics_fill_rect(ctx, _colonTop, 0, GCornerNone);
@@ -231,6 +491,11 @@ static void timeLayerUpdateProc(Layer *layer, GContext *ctx) {
   }
 }
 
+// Whether the last time is fully drawn, digits, colon and AM/PM.
+static bool timeIsSettled() {
+  return (_stagesDone == ALL_TIME_STAGES);
+}
+
 static uint16_t getHour(uint16_t hour) {
   if (clock_is_24h_style() == true) {
     return hour;
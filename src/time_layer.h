@@ -3,14 +3,27 @@
 #include "digit_layer.h"
 #include "wiper_layer.h"
 
+// How much of the minute animation to play, cut back as the battery runs low.
+typedef enum {
+  TIME_ANIMATION_FULL,
+  TIME_ANIMATION_REDUCED,   // The wipe takes a single sweep
+  TIME_ANIMATION_NONE       // The time changes in a single frame
+} TimeAnimation;
+
 typedef struct {
   Layer *layer;
+  Layer *colonLayer;
   DigitLayerData *digitData[4];
   RotAnimation amPm;
+  GBitmap *amPmBitmaps[2];    // Held so switching AM/PM doesn't reload the image
   int16_t lastUpdateMinute;
   WiperLayerData *wiperData;
+  TimeAnimation animation;
 } TimeLayerData;
 
 TimeLayerData* CreateTimeLayer(Layer* relativeLayer, LayerRelation relation);
 void DrawTimeLayer(TimeLayerData *data, uint16_t hour, uint16_t minute);
+void RenderTimeImmediate(TimeLayerData *data, uint16_t hour, uint16_t minute);
+void AnimateTimeLayer(TimeLayerData *data);
+void SetTimeAnimation(TimeLayerData *data, TimeAnimation animation);
 void DestroyTimeLayer(TimeLayerData *data);
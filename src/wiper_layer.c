@@ -3,20 +3,49 @@
 
 typedef struct {
   int16_t divider;
-  uint16_t leftShade;
-  uint16_t rightShade;
+  uint8_t leftShade;
+  uint8_t rightShade;
 } LineShade;
 
+// Where the wiper at one angle crosses the wipe lines, stepped down a line at a
+// time with the same integer math as computing each line from scratch.
+typedef struct {
+  int32_t length;         // Pixels along the wiper from the bolt to the line
+  int32_t remainder;      // Of the division giving length, always below divisor
+  int32_t lengthStep;
+  int32_t remainderStep;
+  int32_t divisor;        // -cos of the angle, 0 when the wiper is level
+  int32_t sine;
+  int16_t x;              // -1 or SCREEN_WIDTH when off screen
+} WiperEdge;
+
+typedef struct {
+  uint16_t shade;
+  int16_t drawNPixels;
+  int16_t everyNPixels;
+  uint32_t masks[4];
+} DitherPattern;
+
 #define ROTATION_INCREMENT_DURATION 60  // milliseconds
 #define WIPE_FINISHED_DURATION (ROTATION_INCREMENT_DURATION * 3)  // milliseconds
 #define ROTATION_INCREMENT 20           // degrees
-#define NUM_SHADES 3
 
 #define LEFT_WIPER_DEGREE 270
 #define RIGHT_WIPER_DEGREE 90
 #define WIPER_SWEEP_DEGREES 180
+#define NUM_WIPER_POSITIONS ((WIPER_SWEEP_DEGREES / ROTATION_INCREMENT) + 1)
+
+// Each sweep is a step every ROTATION_INCREMENT_DURATION, and all but the last
+// sweep wait WIPE_FINISHED_DURATION after their last step instead.
+#define STEPS_PER_SWEEP (WIPER_SWEEP_DEGREES / ROTATION_INCREMENT)
+#define SWEEP_DURATION ((STEPS_PER_SWEEP - 1) * ROTATION_INCREMENT_DURATION + WIPE_FINISHED_DURATION)  // milliseconds
 
 #define BOLT_DIAMETER 6
+#define NO_SHADE_ANGLE -1
+
+// Heap allowed for pre-rotated wiper sprites. If the sprites don't fit the
+// wiper is rotated live instead. Set to 0 to always rotate live.
+#define WIPER_SPRITE_BUDGET 4096  // bytes
 
 static uint16_t _shades[NUM_SHADES] = { 50, 75, 100 };
 
@@ -24,31 +53,69 @@ static GPoint _wiperCenterPoint = {1, 123};
 static GSize _wiperOffset = {-52, -117};
 static GPoint _boltCenterPoint = {71, 6};
 
-static GRect _wipeRect;
-static LineShade *_lineShades = NULL;
+// Black pixels of each shade for a 32 pixel frame buffer word. Bit n is column
+// n of the word, and the mask is picked by the column the pattern starts at
+// mod 4, so every pattern has to repeat within 4 pixels.
+static const DitherPattern _ditherPatterns[] = {
+  { 25, 1, 4, { 0x11111111, 0x22222222, 0x44444444, 0x88888888 } },
+  { 50, 1, 2, { 0x55555555, 0xaaaaaaaa, 0x55555555, 0xaaaaaaaa } },
+  { 75, 3, 4, { 0x77777777, 0xeeeeeeee, 0xdddddddd, 0xbbbbbbbb } },
+  { 100, 1, 1, { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff } }
+};
 
 static void boltLayerUpdateProc(Layer *layer, GContext *ctx);
 static void wipeLayerUpdateProc(Layer *layer, GContext *ctx);
 static void rotationTimerCallback(void *callback_data);
-static int16_t getWiperX(int16_t yPos, int32_t angleDegree);
-static void drawHorizontalLine(GContext *ctx, int16_t yPos, int16_t startX, int16_t endX, uint16_t shade, bool drawLeftToRight);
-static void greyPixelDistribution(uint16_t shade, int16_t *drawNPixels, int16_t *everyNPixels);
+static void stepWiper(WiperLayerData *data, GRect *dirtyBand);
+static uint32_t getStepDueMs(uint16_t step);
+static uint32_t getWipeElapsedMs(WiperLayerData *data);
+static void spriteLayerUpdateProc(Layer *layer, GContext *ctx);
+static void setWiperAngle(WiperLayerData *data, int32_t angleDegree);
+static WiperSprite *createSprites(GBitmap *bitmap, GRect rotFrame);
+static uint16_t rasterizeSprite(GBitmap *bitmap, GRect rotFrame, int32_t angleDegree, WiperSprite *sprite);
+static WiperSprite *getSprite(WiperLayerData *data, int32_t angleDegree);
+static void startWiperEdge(WiperEdge *edge, int16_t yPos, int32_t angleDegree);
+static void stepWiperEdge(WiperEdge *edge);
+static void setWiperEdgeX(WiperEdge *edge);
+static void shadeLines(WiperLayerData *data, bool previouslyMovingRight, uint8_t previousShade, GRect *dirtyBand);
+static void updateShadedLine(WiperLayerData *data, GRect *dirtyBand, int16_t line, LineShade *before, LineShade *after);
+static void setShadeRuns(WiperLayerData *data, int16_t endLine, bool leftSide, uint8_t shade);
+static void appendShadeRun(ShadeRun *runs, uint8_t *numRuns, int16_t firstLine, uint8_t leftShade, uint8_t rightShade);
+static uint8_t findShadeRun(ShadeRun *runs, uint8_t numRuns, int16_t line);
+static int16_t getShadeRunEnd(WiperLayerData *data, ShadeRun *runs, uint8_t numRuns, uint8_t run);
+static bool addChangedColumns(WiperLayerData *data, GRect *band, int16_t line, LineShade *before, LineShade *after);
+static void drawShadedLine(WiperLayerData *data, uint32_t *row, int16_t line, LineShade *lineShade);
+static void clearShadeCache(WiperLayerData *data);
+static void growBand(GRect *band, GRect rect);
+static void drawHorizontalLine(GRect *wipeRect, uint32_t *row, int16_t yPos, int16_t startX, int16_t endX, uint16_t shade, bool drawLeftToRight);
+static void fillSpan(uint32_t *row, int16_t firstX, int16_t lastX, uint32_t blackMask);
+static const DitherPattern *getDitherPattern(uint16_t shade);
 
 WiperLayerData* CreateWiperLayer(Layer *relativeLayer, LayerRelation relation, GRect wipeRect) {
-  WiperLayerData *data = malloc(sizeof(WiperLayerData));
+  WiperLayerData *data = ArenaAlloc(sizeof(WiperLayerData));
   if (data != NULL) {
     memset(data, 0, sizeof(WiperLayerData));
     
-    // Wipe layer
-    _wipeRect = wipeRect;
-    _lineShades = malloc(sizeof(LineShade) * (_wipeRect.size.h + 1));
-    memset(_lineShades, 0, sizeof(LineShade) * (_wipeRect.size.h + 1));
-    data->wipeLayer = layer_create(_wipeRect);
+    // Wipe layer. All lines start out in one unshaded run.
+    data->wipeRect = wipeRect;
+    data->numShadeRuns = 1;
+    data->shadeAngle = NO_SHADE_ANGLE;
+    
+    // Settled shading is kept offscreen as full screen width lines, so drawing
+    // it is one AND per frame buffer word. Without it every line is dithered again.
+    data->shadeCache = gbitmap_create_blank(GSize(SCREEN_WIDTH, data->wipeRect.size.h));
+    if (data->shadeCache != NULL) {
+      memset(data->shadeCache->addr, 0xff, data->shadeCache->row_size_bytes * data->wipeRect.size.h);
+    }
+    
+    data->wipeLayer = layer_create_with_data(data->wipeRect, sizeof(WiperLayerData*));
+    *(WiperLayerData**) layer_get_data(data->wipeLayer) = data;
     layer_set_update_proc(data->wipeLayer, wipeLayerUpdateProc);
     AddLayer(relativeLayer, data->wipeLayer, relation);
     
     // Wiper layer
-    CreateRotBitmapGroup(&data->wiper.group, relativeLayer, relation, NULL, RESOURCE_ID_IMAGE_WIPER, GCompOpAssign);
+    CreateRotBitmapGroup(&data->wiper.group, relativeLayer, relation, RESOURCE_ID_IMAGE_WIPER, GCompOpAssign);
+    RotBitmapGroupSetAngle(&data->wiper.group, LEFT_WIPER_DEGREE);
     rot_bitmap_set_src_ic(data->wiper.group.layer, _wiperCenterPoint);
 
     GRect rotFrame = layer_get_frame((Layer*) data->wiper.group.layer);    
@@ -56,12 +123,26 @@ WiperLayerData* CreateWiperLayer(Layer *relativeLayer, LayerRelation relation, G
     rotFrame.origin.x = _wiperOffset.w;
     rotFrame.origin.y = _wiperOffset.h;
     layer_set_frame((Layer*) data->wiper.group.layer, rotFrame);
-
-    rot_bitmap_layer_set_angle(data->wiper.group.layer, PEBBLE_ANGLE_FROM_DEGREE(LEFT_WIPER_DEGREE));
-    data->wiper.group.angle = LEFT_WIPER_DEGREE;
     
-    // Wiper bolt layer
-    data->boltLayer = layer_create(GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT));
+    // The wiper only stops at a few angles, so when they fit in the budget it is
+    // rotated once to each of them here and the rotating layer is hidden.
+    data->sprites = createSprites(data->wiper.group.bitmap, rotFrame);
+    if (data->sprites != NULL) {
+      GRect spriteFrame = GRectZero;
+      for (int position = 0; position < NUM_WIPER_POSITIONS; position++) {
+        growBand(&spriteFrame, data->sprites[position].bounds);
+      }
+      
+      data->spriteLayer = layer_create_with_data(spriteFrame, sizeof(WiperLayerData*));
+      *(WiperLayerData**) layer_get_data(data->spriteLayer) = data;
+      layer_set_update_proc(data->spriteLayer, spriteLayerUpdateProc);
+      AddLayer(relativeLayer, data->spriteLayer, relation);
+      layer_set_hidden((Layer*) data->wiper.group.layer, true);
+    }
+    
+    // Wiper bolt layer. Framed tightly around the bolt so it doesn't cover the screen.
+    data->boltLayer = layer_create(GRect(_boltCenterPoint.x - BOLT_DIAMETER, _boltCenterPoint.y - BOLT_DIAMETER, 
+                                         (BOLT_DIAMETER * 2) + 1, (BOLT_DIAMETER * 2) + 1));
     layer_set_update_proc(data->boltLayer, boltLayerUpdateProc);
     AddLayer(relativeLayer, data->boltLayer, relation);
   }
@@ -72,17 +153,29 @@ WiperLayerData* CreateWiperLayer(Layer *relativeLayer, LayerRelation relation, G
 void DrawWiperLayer(WiperLayerData *data) {
 }
 
-void RunWiper(WiperLayerData *data, WiperFinishedCallback finishedCallback, void *wiperFinishedCallbackData) {
+// Sweeps the wiper from side to side, a shade darker each sweep. Sweeps are
+// kept to 1 to NUM_SHADES, fewer skip the lighter shades as the last one
+// always blacks the wipe area out.
+void RunWiper(WiperLayerData *data, uint8_t sweeps, WiperFinishedCallback finishedCallback, void *wiperFinishedCallbackData) {
   ClearWiper(data);
   
+  if (sweeps < 1) {
+    sweeps = 1;
+    
+  } else if (sweeps > NUM_SHADES) {
+    sweeps = NUM_SHADES;
+  }
+  
   data->finishedCallback = finishedCallback;
   data->wiperFinishedCallbackData = wiperFinishedCallbackData;
   
   data->wiper.rotationIncrement = ROTATION_INCREMENT * ((data->wiper.group.angle == LEFT_WIPER_DEGREE) ? -1 : 1);
   data->wiper.rotationAmount = WIPER_SWEEP_DEGREES;
   data->wiper.endAngle = (data->wiper.group.angle == LEFT_WIPER_DEGREE) ? RIGHT_WIPER_DEGREE : LEFT_WIPER_DEGREE;
-  data->shadeIndex = 0;
-  data->wiper.rotationTimer = app_timer_register(ROTATION_INCREMENT_DURATION, (AppTimerCallback) rotationTimerCallback, (void*) data);
+  data->shadeIndex = NUM_SHADES - sweeps;
+  data->wipeStep = 0;
+  time_ms(&data->wipeStartSeconds, &data->wipeStartMs);
+  data->wiper.rotationTimer = app_timer_register(getStepDueMs(0), (AppTimerCallback) rotationTimerCallback, (void*) data);
 }
 
 void ClearWiper(WiperLayerData *data) {
@@ -91,13 +184,14 @@ void ClearWiper(WiperLayerData *data) {
     data->wiper.rotationTimer = NULL;
   
     // Wiper was in motion. Set wiper to angle degree it was headed to.
-    rot_bitmap_layer_set_angle(data->wiper.group.layer, PEBBLE_ANGLE_FROM_DEGREE(data->wiper.endAngle));
-    data->wiper.group.angle = data->wiper.endAngle;
+    setWiperAngle(data, data->wiper.endAngle);
   }
 
-  if (_lineShades != NULL) {
-    memset(_lineShades, 0, sizeof(LineShade) * (_wipeRect.size.h + 1));
-  }
+  clearShadeCache(data);
+  memset(data->shadeRuns, 0, sizeof(data->shadeRuns));
+  data->numShadeRuns = 1;
+  data->shadeAngle = NO_SHADE_ANGLE;
+  data->shadedBand = GRectZero;
   
   data->finishedCallback = NULL;
   data->wiperFinishedCallbackData = NULL;
@@ -114,6 +208,17 @@ void DestroyWiperLayer(WiperLayerData *data) {
     
     DestroyRotBitmapGroup(&data->wiper.group);
     
+    if (data->spriteLayer != NULL) {
+      layer_remove_from_parent(data->spriteLayer);
+      layer_destroy(data->spriteLayer);
+      data->spriteLayer = NULL;
+    }
+    
+    if (data->sprites != NULL) {
+      ArenaFree(data->sprites);
+      data->sprites = NULL;
+    }
+    
     if (data->boltLayer != NULL) {
       layer_remove_from_parent(data->boltLayer);
       layer_destroy(data->boltLayer);
@@ -126,22 +231,53 @@ void DestroyWiperLayer(WiperLayerData *data) {
       data->wipeLayer = NULL;
     }
     
-    if (_lineShades != NULL) {
-      free(_lineShades);
-      _lineShades = NULL;
+    if (data->shadeCache != NULL) {
+      gbitmap_destroy(data->shadeCache);
+      data->shadeCache = NULL;
     }
     
-    free(data);
+    ArenaFree(data);
   }
 }
 
+// Steps are due at fixed times after RunWiper. When the callback runs late
+// every step that is due is taken but only the last one is drawn, so a busy
+// watch drops frames instead of stretching the wipe.
 static void rotationTimerCallback(void *callback_data) {
   WiperLayerData *data = (WiperLayerData*) callback_data;
   data->wiper.rotationTimer = NULL;
-  bool wipeFinished = false;
-  bool previouslyMovingRight = (data->wiper.rotationIncrement < 0);
-  uint16_t previousShade = _shades[data->shadeIndex];
+  uint32_t elapsedMs = getWipeElapsedMs(data);
+  
+  // Track which part of the wipe area changes shade this tick.
+  GRect dirtyBand = GRectZero;
+  do {
+    stepWiper(data, &dirtyBand);
+  } while (data->wiper.rotationAmount > 0 && getStepDueMs(data->wipeStep) <= elapsedMs);
+  
+  setWiperAngle(data, data->wiper.group.angle);
+  
+  // The wiper layer redraws the window anyway, so only invalidate the wipe layer
+  // when its shading changed.
+  if (!grect_is_empty(&dirtyBand)) {
+    growBand(&data->shadedBand, dirtyBand);
+    layer_mark_dirty(data->wipeLayer);
+  }
+  
+  if (data->wiper.rotationAmount > 0) {
+    uint32_t dueMs = getStepDueMs(data->wipeStep);
+    data->wiper.rotationTimer = app_timer_register((dueMs > elapsedMs) ? (dueMs - elapsedMs) : 1, (AppTimerCallback) rotationTimerCallback, (void*) data);
     
+  } else if (data->finishedCallback != NULL) {
+    data->finishedCallback(data->wiperFinishedCallbackData);
+  }
+}
+
+// Moves the wiper one ROTATION_INCREMENT and shades the lines it passed.
+static void stepWiper(WiperLayerData *data, GRect *dirtyBand) {
+  bool previouslyMovingRight = (data->wiper.rotationIncrement < 0);
+  uint8_t previousShade = _shades[data->shadeIndex];
+  
+  data->wipeStep++;
   data->wiper.rotationAmount -= abs(data->wiper.rotationIncrement);
   if (data->wiper.rotationAmount > 0) {
     data->wiper.group.angle += data->wiper.rotationIncrement;
@@ -153,7 +289,6 @@ static void rotationTimerCallback(void *callback_data) {
     }
   } else {
     // Done with a wipe.
-    wipeFinished = true;
     data->wiper.group.angle = data->wiper.endAngle;
     data->shadeIndex++;
     
@@ -164,196 +299,567 @@ static void rotationTimerCallback(void *callback_data) {
       data->wiper.endAngle = (data->wiper.group.angle == LEFT_WIPER_DEGREE) ? RIGHT_WIPER_DEGREE : LEFT_WIPER_DEGREE;
     }
   }
+  
+  shadeLines(data, previouslyMovingRight, previousShade, dirtyBand);
+}
 
-  rot_bitmap_layer_set_angle(data->wiper.group.layer, PEBBLE_ANGLE_FROM_DEGREE(data->wiper.group.angle));
+// Milliseconds after RunWiper the step is due.
+static uint32_t getStepDueMs(uint16_t step) {
+  return ((step / STEPS_PER_SWEEP) * SWEEP_DURATION) + (((step % STEPS_PER_SWEEP) + 1) * ROTATION_INCREMENT_DURATION);
+}
 
-  for (int line = 0; line < _wipeRect.size.h + 1; line++) {
-    int16_t xPos = getWiperX(_wipeRect.origin.y + line, data->wiper.group.angle);
-    _lineShades[line].divider = xPos;
-    if (xPos < 0) {
-      // Set shade right if moving left. Otherwise, the wiper is moving right but hasn't reached the wipe area yet.
-      if (previouslyMovingRight == false) {
-        _lineShades[line].rightShade = previousShade;
-      }
-    } else if (xPos >= SCREEN_WIDTH) {
-      // Set shade left if moving right. Otherwise, the wiper is moving left but hasn't reached the wipe area yet.
+static uint32_t getWipeElapsedMs(WiperLayerData *data) {
+  time_t seconds;
+  uint16_t ms;
+  time_ms(&seconds, &ms);
+  return ((seconds - data->wipeStartSeconds) * 1000) + ms - data->wipeStartMs;
+}
+
+// Shades the lines the wiper passed over since the last tick. The wiper only
+// moved inside the wedge between its previous and new edges, so those are the
+// only lines stepped through one by one. Below the wedge both edges are off
+// screen and a line only changes if its run of shading does.
+static void shadeLines(WiperLayerData *data, bool previouslyMovingRight, uint8_t previousShade, GRect *dirtyBand) {
+  int16_t numLines = data->wipeRect.size.h + 1;
+  ShadeRun previousRuns[WIPER_SHADE_RUNS];
+  uint8_t numPreviousRuns = data->numShadeRuns;
+  memcpy(previousRuns, data->shadeRuns, sizeof(ShadeRun) * numPreviousRuns);
+  
+  WiperEdge previousEdge;
+  WiperEdge edge;
+  startWiperEdge(&previousEdge, data->wipeRect.origin.y, (data->shadeAngle == NO_SHADE_ANGLE) ? data->wiper.group.angle : data->shadeAngle);
+  startWiperEdge(&edge, data->wipeRect.origin.y, data->wiper.group.angle);
+  
+  // The side the wiper came from is shaded on lines it crosses on screen, and
+  // on lines it has already left the screen for on the side it is heading to.
+  // The wiper moves away from the bolt down the lines, so those lines come first.
+  int16_t shadedLines = 0;
+  uint8_t run = 0;
+  int16_t line = 0;
+  for (; line < numLines; line++) {
+    bool onScreen = (edge.x >= 0 && edge.x < SCREEN_WIDTH);
+    if (!onScreen && previousEdge.x == edge.x) {
+      break;
+    }
+    
+    if (run + 1 < numPreviousRuns && previousRuns[run + 1].firstLine == line) {
+      run++;
+    }
+    
+    LineShade before = { previousEdge.x, previousRuns[run].leftShade, previousRuns[run].rightShade };
+    LineShade after = before;
+    after.divider = edge.x;
+    if (previouslyMovingRight ? (edge.x >= 0) : (edge.x < SCREEN_WIDTH)) {
+      shadedLines = line + 1;
       if (previouslyMovingRight) {
-        _lineShades[line].leftShade = previousShade;
+        after.leftShade = previousShade;
+        
+      } else {
+        after.rightShade = previousShade;
       }
-    } else if (previouslyMovingRight) {
-      // Moving right, set shade left
-      _lineShades[line].leftShade = previousShade;
-      
-    } else {
-      // Moving left, set shade right
-      _lineShades[line].rightShade = previousShade;
     }
+    
+    updateShadedLine(data, dirtyBand, line, &before, &after);
+    stepWiperEdge(&previousEdge);
+    stepWiperEdge(&edge);
   }
   
-  layer_mark_dirty(data->wipeLayer);
+  int16_t wedgeEnd = line;
+  if (wedgeEnd < numLines && (previouslyMovingRight ? (edge.x >= 0) : (edge.x < SCREEN_WIDTH))) {
+    shadedLines = numLines;
+  }
   
-  if (data->wiper.rotationAmount > 0) {
-    data->wiper.rotationTimer = app_timer_register((wipeFinished ? WIPE_FINISHED_DURATION : ROTATION_INCREMENT_DURATION), (AppTimerCallback) rotationTimerCallback, (void*) data);
+  setShadeRuns(data, shadedLines, previouslyMovingRight, previousShade);
+  data->shadeAngle = data->wiper.group.angle;
+  
+  // Below the wedge the wiper is off screen on the same side for both edges
+  for (line = wedgeEnd; line < numLines; ) {
+    uint8_t previousRun = findShadeRun(previousRuns, numPreviousRuns, line);
+    uint8_t newRun = findShadeRun(data->shadeRuns, data->numShadeRuns, line);
+    int16_t previousEnd = getShadeRunEnd(data, previousRuns, numPreviousRuns, previousRun);
+    int16_t newEnd = getShadeRunEnd(data, data->shadeRuns, data->numShadeRuns, newRun);
+    int16_t endLine = (previousEnd < newEnd) ? previousEnd : newEnd;
     
-  } else if (data->finishedCallback != NULL) {
-    data->finishedCallback(data->wiperFinishedCallbackData);
+    LineShade before = { edge.x, previousRuns[previousRun].leftShade, previousRuns[previousRun].rightShade };
+    LineShade after = { edge.x, data->shadeRuns[newRun].leftShade, data->shadeRuns[newRun].rightShade };
+    if (before.leftShade != after.leftShade || before.rightShade != after.rightShade) {
+      for (; line < endLine; line++) {
+        updateShadedLine(data, dirtyBand, line, &before, &after);
+      }
+    }
+    
+    line = endLine;
+  }
+}
+
+// Grows dirtyBand by the columns of the line that change shade and draws the
+// line again in the shade cache if any do.
+static void updateShadedLine(WiperLayerData *data, GRect *dirtyBand, int16_t line, LineShade *before, LineShade *after) {
+  if (addChangedColumns(data, dirtyBand, line, before, after) && data->shadeCache != NULL) {
+    uint32_t *cacheRow = (uint32_t*) ((uint8_t*) data->shadeCache->addr + (line * data->shadeCache->row_size_bytes));
+    memset(cacheRow, 0xff, data->shadeCache->row_size_bytes);
+    drawShadedLine(data, cacheRow, line, after);
+  }
+}
+
+// Sets the shade of one side of the wiper for lines above endLine.
+static void setShadeRuns(WiperLayerData *data, int16_t endLine, bool leftSide, uint8_t shade) {
+  ShadeRun runs[WIPER_SHADE_RUNS];
+  uint8_t numRuns = 0;
+  
+  for (uint8_t run = 0; run < data->numShadeRuns; run++) {
+    ShadeRun *shadeRun = &data->shadeRuns[run];
+    int16_t runEnd = getShadeRunEnd(data, data->shadeRuns, data->numShadeRuns, run);
+    if (shadeRun->firstLine < endLine) {
+      appendShadeRun(runs, &numRuns, shadeRun->firstLine, leftSide ? shade : shadeRun->leftShade, leftSide ? shadeRun->rightShade : shade);
+    }
+    
+    if (runEnd > endLine) {
+      int16_t firstLine = (shadeRun->firstLine > endLine) ? shadeRun->firstLine : endLine;
+      appendShadeRun(runs, &numRuns, firstLine, shadeRun->leftShade, shadeRun->rightShade);
+    }
+  }
+  
+  memcpy(data->shadeRuns, runs, sizeof(ShadeRun) * numRuns);
+  data->numShadeRuns = numRuns;
+}
+
+// At each stop angle the wiper leaves the screen at one line at most, so runs
+// only start at those lines and there are never more than the array holds.
+static void appendShadeRun(ShadeRun *runs, uint8_t *numRuns, int16_t firstLine, uint8_t leftShade, uint8_t rightShade) {
+  if (*numRuns > 0 && runs[*numRuns - 1].leftShade == leftShade && runs[*numRuns - 1].rightShade == rightShade) {
+    return;
+  }
+  
+  if (*numRuns < WIPER_SHADE_RUNS) {
+    runs[*numRuns].firstLine = firstLine;
+    runs[*numRuns].leftShade = leftShade;
+    runs[*numRuns].rightShade = rightShade;
+    (*numRuns)++;
+  }
+}
+
+static uint8_t findShadeRun(ShadeRun *runs, uint8_t numRuns, int16_t line) {
+  uint8_t run = 0;
+  while (run + 1 < numRuns && runs[run + 1].firstLine <= line) {
+    run++;
+  }
+  
+  return run;
+}
+
+static int16_t getShadeRunEnd(WiperLayerData *data, ShadeRun *runs, uint8_t numRuns, uint8_t run) {
+  return (run + 1 < numRuns) ? runs[run + 1].firstLine : data->wipeRect.size.h + 1;
+}
+
+static void setWiperAngle(WiperLayerData *data, int32_t angleDegree) {
+  if (data->sprites == NULL) {
+    RotBitmapGroupSetAngle(&data->wiper.group, angleDegree);
+    return;
+  }
+  
+  data->wiper.group.angle = angleDegree;
+  layer_mark_dirty(data->spriteLayer);
+}
+
+static void spriteLayerUpdateProc(Layer *layer, GContext *ctx) {
+  // The sprite is copied straight into the frame buffer. The sprite layer's
+  // parent is full screen, so sprite bounds are in screen coordinates.
+  WiperLayerData *data = *(WiperLayerData**) layer_get_data(layer);
+  WiperSprite *sprite = getSprite(data, data->wiper.group.angle);
+  if (sprite == NULL) {
+    return;
+  }
+  
+  GBitmap *frameBuffer = graphics_capture_frame_buffer(ctx);
+  if (frameBuffer == NULL) {
+    return;
+  }
+  
+  uint16_t bit = 0;
+  for (int line = 0; line < sprite->bounds.size.h; line++) {
+    uint8_t *row = (uint8_t*) frameBuffer->addr + ((sprite->bounds.origin.y + line) * frameBuffer->row_size_bytes);
+    int16_t lastX = sprite->rows[line].firstX + sprite->rows[line].width;
+    
+    for (int16_t x = sprite->rows[line].firstX; x < lastX; x++, bit++) {
+      if (sprite->pixels[bit >> 3] & (1 << (bit & 7))) {
+        row[x >> 3] |= (1 << (x & 7));
+        
+      } else {
+        row[x >> 3] &= ~(1 << (x & 7));
+      }
+    }
+  }
+  
+  graphics_release_frame_buffer(ctx, frameBuffer);
+}
+
+// Rotates the wiper to every stop angle. The sprites, their rows and pixels
+// are one allocation. Returns NULL if it would be over WIPER_SPRITE_BUDGET.
+static WiperSprite *createSprites(GBitmap *bitmap, GRect rotFrame) {
+  WiperSprite measured;
+  size_t totalRows = 0;
+  size_t totalPixelBytes = 0;
+  
+  for (int position = 0; position < NUM_WIPER_POSITIONS; position++) {
+    memset(&measured, 0, sizeof(WiperSprite));
+    uint16_t numPixels = rasterizeSprite(bitmap, rotFrame, RIGHT_WIPER_DEGREE + (position * ROTATION_INCREMENT), &measured);
+    totalRows += measured.bounds.size.h;
+    totalPixelBytes += (numPixels + 7) / 8;
+  }
+  
+  size_t size = (sizeof(WiperSprite) * NUM_WIPER_POSITIONS) + (sizeof(SpriteRow) * totalRows) + totalPixelBytes;
+  MY_APP_LOG(APP_LOG_LEVEL_DEBUG, "Wiper sprites need %i bytes", (int) size);
+  if (size > WIPER_SPRITE_BUDGET) {
+    return NULL;
+  }
+  
+  WiperSprite *sprites = ArenaAlloc(size);
+  if (sprites == NULL) {
+    return NULL;
+  }
+  
+  memset(sprites, 0, size);
+  SpriteRow *rows = (SpriteRow*) (sprites + NUM_WIPER_POSITIONS);
+  uint8_t *pixels = (uint8_t*) (rows + totalRows);
+  
+  for (int position = 0; position < NUM_WIPER_POSITIONS; position++) {
+    sprites[position].rows = rows;
+    sprites[position].pixels = pixels;
+    uint16_t numPixels = rasterizeSprite(bitmap, rotFrame, RIGHT_WIPER_DEGREE + (position * ROTATION_INCREMENT), &sprites[position]);
+    rows += sprites[position].bounds.size.h;
+    pixels += (numPixels + 7) / 8;
+  }
+  
+  return sprites;
+}
+
+// Sets the bounds of the wiper rotated to the angle and returns how many pixels
+// it covers. Rows and pixels are only filled in if the sprite has them. Pixels
+// are mapped back into the bitmap the same way RotBitmapLayer draws, around the
+// center of rotFrame, and clipped to rotFrame and the screen.
+static uint16_t rasterizeSprite(GBitmap *bitmap, GRect rotFrame, int32_t angleDegree, WiperSprite *sprite) {
+  int32_t angle = PEBBLE_ANGLE_FROM_DEGREE(angleDegree);
+  int32_t cosine = cos_lookup(angle);
+  int32_t sine = sin_lookup(angle);
+  GPoint center = GPoint(rotFrame.origin.x + (rotFrame.size.w / 2), rotFrame.origin.y + (rotFrame.size.h / 2));
+  GSize size = bitmap->bounds.size;
+  
+  // Bounding box of the rotated bitmap corners, one pixel larger for rounding
+  GRect bounds = GRectZero;
+  for (int corner = 0; corner < 4; corner++) {
+    int32_t sourceX = ((corner & 1) ? size.w : 0) - _wiperCenterPoint.x;
+    int32_t sourceY = ((corner & 2) ? size.h : 0) - _wiperCenterPoint.y;
+    int16_t x = center.x + (int16_t) (((sourceX * cosine) - (sourceY * sine)) / TRIG_MAX_RATIO);
+    int16_t y = center.y + (int16_t) (((sourceX * sine) + (sourceY * cosine)) / TRIG_MAX_RATIO);
+    growBand(&bounds, GRect(x - 1, y - 1, 3, 3));
+  }
+  
+  grect_clip(&bounds, &rotFrame);
+  GRect screen = GRect(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+  grect_clip(&bounds, &screen);
+  sprite->bounds = bounds;
+  
+  uint16_t numPixels = 0;
+  for (int line = 0; line < bounds.size.h; line++) {
+    int32_t relY = bounds.origin.y + line - center.y;
+    int16_t firstX = -1;
+    int16_t lastX = -1;
+    
+    for (int16_t x = bounds.origin.x; x < bounds.origin.x + bounds.size.w; x++) {
+      int32_t relX = x - center.x;
+      int32_t sourceX = _wiperCenterPoint.x + (((relX * cosine) + (relY * sine)) / TRIG_MAX_RATIO);
+      int32_t sourceY = _wiperCenterPoint.y + (((relY * cosine) - (relX * sine)) / TRIG_MAX_RATIO);
+      if (sourceX < 0 || sourceX >= size.w || sourceY < 0 || sourceY >= size.h) {
+        continue;
+      }
+      
+      // The rotated bitmap is convex, so covered pixels are one run per line.
+      firstX = (firstX < 0) ? x : firstX;
+      lastX = x;
+      
+      if (sprite->pixels != NULL) {
+        uint8_t *sourceRow = (uint8_t*) bitmap->addr + ((bitmap->bounds.origin.y + sourceY) * bitmap->row_size_bytes);
+        int16_t bitmapX = bitmap->bounds.origin.x + sourceX;
+        if (sourceRow[bitmapX >> 3] & (1 << (bitmapX & 7))) {
+          sprite->pixels[numPixels >> 3] |= (1 << (numPixels & 7));
+        }
+      }
+      
+      numPixels++;
+    }
+    
+    if (sprite->rows != NULL) {
+      sprite->rows[line].firstX = (firstX < 0) ? 0 : firstX;
+      sprite->rows[line].width = (firstX < 0) ? 0 : (lastX - firstX + 1);
+    }
   }
+  
+  return numPixels;
+}
+
+// Returns the sprite for the angle, or NULL if the angle isn't one the wiper stops at.
+static WiperSprite *getSprite(WiperLayerData *data, int32_t angleDegree) {
+  int32_t offset = angleDegree - RIGHT_WIPER_DEGREE;
+  if (data->sprites == NULL || offset < 0 || offset > WIPER_SWEEP_DEGREES || (offset % ROTATION_INCREMENT) != 0) {
+    return NULL;
+  }
+  
+  return &data->sprites[offset / ROTATION_INCREMENT];
 }
 
 static void boltLayerUpdateProc(Layer *layer, GContext *ctx) {
+  GPoint center = GPoint(BOLT_DIAMETER, BOLT_DIAMETER);
+  
   graphics_context_set_fill_color(ctx, GColorWhite);
-  graphics_fill_circle(ctx, _boltCenterPoint, BOLT_DIAMETER);
+  graphics_fill_circle(ctx, center, BOLT_DIAMETER);
   
   graphics_context_set_fill_color(ctx, GColorBlack);
-  graphics_fill_circle(ctx, _boltCenterPoint, 1);
+  graphics_fill_circle(ctx, center, 1);
 }
 
 static void wipeLayerUpdateProc(Layer *layer, GContext *ctx) {
-  graphics_context_set_stroke_color(ctx, GColorBlack);
+  // Shades are written straight into the frame buffer a word at a time. The
+  // wipe layer's parent is full screen, so wipeRect is in screen coordinates.
+  WiperLayerData *data = *(WiperLayerData**) layer_get_data(layer);
+  GRect *band = &data->shadedBand;
+  if (grect_is_empty(band)) {
+    return;
+  }
   
-  for (int line = 0; line < _wipeRect.size.h + 1; line++) {
-    if (_lineShades[line].divider > 0 && _lineShades[line].leftShade != 0) {
-      drawHorizontalLine(ctx, line, 0, _lineShades[line].divider - 1, _lineShades[line].leftShade, true);
+  GBitmap *frameBuffer = graphics_capture_frame_buffer(ctx);
+  if (frameBuffer == NULL) {
+    return;
+  }
+  
+  if (data->shadeCache != NULL) {
+    // Cache lines are all ones except for the black of their shading
+    for (int line = band->origin.y; line < band->origin.y + band->size.h; line++) {
+      uint32_t *row = (uint32_t*) ((uint8_t*) frameBuffer->addr + ((data->wipeRect.origin.y + line) * frameBuffer->row_size_bytes));
+      uint32_t *cacheRow = (uint32_t*) ((uint8_t*) data->shadeCache->addr + (line * data->shadeCache->row_size_bytes));
+      for (int word = 0; word < (SCREEN_WIDTH + 31) / 32; word++) {
+        row[word] &= cacheRow[word];
+      }
     }
     
-    if (_lineShades[line].divider < (SCREEN_WIDTH - 1) && _lineShades[line].rightShade != 0) {
-      drawHorizontalLine(ctx, line, _lineShades[line].divider + 1, SCREEN_WIDTH - 1, _lineShades[line].rightShade, false);
+    graphics_release_frame_buffer(ctx, frameBuffer);
+    return;
+  }
+  
+  // Unshaded runs and lines outside the shaded band have nothing to draw
+  for (int run = 0; run < data->numShadeRuns; run++) {
+    ShadeRun *shadeRun = &data->shadeRuns[run];
+    if (shadeRun->leftShade == 0 && shadeRun->rightShade == 0) {
+      continue;
+    }
+    
+    int16_t firstLine = (shadeRun->firstLine > band->origin.y) ? shadeRun->firstLine : band->origin.y;
+    int16_t endLine = (run + 1 < data->numShadeRuns) ? data->shadeRuns[run + 1].firstLine : data->wipeRect.size.h;
+    endLine = (endLine < band->origin.y + band->size.h) ? endLine : band->origin.y + band->size.h;
+    
+    WiperEdge edge;
+    startWiperEdge(&edge, data->wipeRect.origin.y + firstLine, data->shadeAngle);
+    for (int16_t line = firstLine; line < endLine; line++, stepWiperEdge(&edge)) {
+      uint32_t *row = (uint32_t*) ((uint8_t*) frameBuffer->addr + ((data->wipeRect.origin.y + line) * frameBuffer->row_size_bytes));
+      LineShade lineShade = { edge.x, shadeRun->leftShade, shadeRun->rightShade };
+      drawShadedLine(data, row, line, &lineShade);
     }
   }
+  
+  graphics_release_frame_buffer(ctx, frameBuffer);
 }
 
-static int16_t getWiperX(int16_t yPos, int32_t angleDegree) {
+// Starts the edge on the line at yPos, which has to be below the bolt.
+static void startWiperEdge(WiperEdge *edge, int16_t yPos, int32_t angleDegree) {
+  memset(edge, 0, sizeof(WiperEdge));
   if (angleDegree == LEFT_WIPER_DEGREE) {
-    return -1;
+    edge->x = -1;
+    return;
     
   } else if (angleDegree == RIGHT_WIPER_DEGREE) {
-    return SCREEN_WIDTH;
+    edge->x = SCREEN_WIDTH;
+    return;
   }
   
-  int16_t wiperLength = 0;
-  int16_t wiperX = 0;
   int32_t angle = PEBBLE_ANGLE_FROM_DEGREE(angleDegree);
+  int32_t scaledHeight = (yPos - _boltCenterPoint.y) * TRIG_MAX_RATIO;
+  edge->divisor = -cos_lookup(angle);
+  edge->sine = sin_lookup(angle);
+  edge->length = scaledHeight / edge->divisor;
+  edge->remainder = scaledHeight % edge->divisor;
+  edge->lengthStep = TRIG_MAX_RATIO / edge->divisor;
+  edge->remainderStep = TRIG_MAX_RATIO % edge->divisor;
+  setWiperEdgeX(edge);
+}
+
+// Moves the edge down a line. The length grows by TRIG_MAX_RATIO / divisor a
+// line, carrying the remainder, so no division is needed.
+static void stepWiperEdge(WiperEdge *edge) {
+  if (edge->divisor == 0) {
+    return;
+  }
   
-  wiperLength = (int16_t)((int32_t)((yPos - _boltCenterPoint.y) * TRIG_MAX_RATIO) / (int32_t)(-cos_lookup(angle)));
-  wiperX = (int16_t)(sin_lookup(angle) * (int32_t)wiperLength / TRIG_MAX_RATIO) + _boltCenterPoint.x;
+  edge->length += edge->lengthStep;
+  edge->remainder += edge->remainderStep;
+  if (edge->remainder >= edge->divisor) {
+    edge->remainder -= edge->divisor;
+    edge->length++;
+  }
   
+  setWiperEdgeX(edge);
+}
+
+static void setWiperEdgeX(WiperEdge *edge) {
+  int16_t wiperX = (int16_t) (edge->sine * edge->length / TRIG_MAX_RATIO) + _boltCenterPoint.x;
   if (wiperX < 0) {
-    return -1;
+    edge->x = -1;
     
   } else if (wiperX >= SCREEN_WIDTH) {
-    return SCREEN_WIDTH;
+    edge->x = SCREEN_WIDTH;
     
   } else {
-    return wiperX;
+    edge->x = wiperX;
   }
 }
 
-static void drawHorizontalLine(GContext *ctx, int16_t yPos, int16_t startX, int16_t endX, uint16_t shade, bool drawLeftToRight) {
-  if (shade >= 100) {
-    graphics_draw_line(ctx, GPoint(startX, yPos), GPoint(endX, yPos));
-    return;
-  } 
-
-  int16_t drawNPixels;
-  int16_t everyNPixels;
+// Grows band to cover the columns of the line whose shading differs between
+// the two line shades. Returns whether any did.
+static bool addChangedColumns(WiperLayerData *data, GRect *band, int16_t line, LineShade *before, LineShade *after) {
+  if (line >= data->wipeRect.size.h) {
+    return false;
+  }
+  
+  int16_t lowDivider = (before->divider < after->divider) ? before->divider : after->divider;
+  int16_t highDivider = (before->divider > after->divider) ? before->divider : after->divider;
+  int16_t firstX = data->wipeRect.size.w;
+  int16_t lastX = -1;
+  
+  // Columns left of both dividers
+  if (before->leftShade != after->leftShade) {
+    firstX = 0;
+    lastX = highDivider - 1;
+  }
+  
+  // Columns right of both dividers
+  if (before->rightShade != after->rightShade) {
+    firstX = (lowDivider + 1 < firstX) ? lowDivider + 1 : firstX;
+    lastX = data->wipeRect.size.w - 1;
+  }
+  
+  // Columns the divider swept over
+  if (lowDivider != highDivider && (before->leftShade | before->rightShade | after->leftShade | after->rightShade) != 0) {
+    firstX = (lowDivider < firstX) ? lowDivider : firstX;
+    lastX = (highDivider > lastX) ? highDivider : lastX;
+  }
+  
+  firstX = (firstX < 0) ? 0 : firstX;
+  lastX = (lastX > data->wipeRect.size.w - 1) ? data->wipeRect.size.w - 1 : lastX;
+  if (firstX > lastX) {
+    return false;
+  }
+  
+  growBand(band, GRect(firstX, line, lastX - firstX + 1, 1));
+  return true;
+}
 
-  greyPixelDistribution(shade, &drawNPixels, &everyNPixels);
+// Blackens the line's shading on both sides of the wiper in row.
+static void drawShadedLine(WiperLayerData *data, uint32_t *row, int16_t line, LineShade *lineShade) {
+  if (lineShade->divider > 0 && lineShade->leftShade != 0) {
+    drawHorizontalLine(&data->wipeRect, row, line, 0, lineShade->divider - 1, lineShade->leftShade, true);
+  }
+  
+  if (lineShade->divider < (SCREEN_WIDTH - 1) && lineShade->rightShade != 0) {
+    drawHorizontalLine(&data->wipeRect, row, line, lineShade->divider + 1, SCREEN_WIDTH - 1, lineShade->rightShade, false);
+  }
+}
 
-  int startPos = (drawLeftToRight ? startX : endX) + (yPos % everyNPixels);
-  int endPos = (drawLeftToRight ? endX : startX);
+// Whitens the lines of the shade cache that hold shading.
+static void clearShadeCache(WiperLayerData *data) {
+  if (data->shadeCache == NULL || grect_is_empty(&data->shadedBand)) {
+    return;
+  }
+  
+  uint8_t *firstRow = (uint8_t*) data->shadeCache->addr + (data->shadedBand.origin.y * data->shadeCache->row_size_bytes);
+  memset(firstRow, 0xff, data->shadedBand.size.h * data->shadeCache->row_size_bytes);
+}
 
-  while (true) {
-    if ((drawLeftToRight && startPos > endPos) || (!drawLeftToRight && startPos < endPos)) {
-      // Done. Break.
-      break;
-    }
+static void growBand(GRect *band, GRect rect) {
+  if (grect_is_empty(band)) {
+    *band = rect;
+    return;
+  }
+  
+  int16_t left = (rect.origin.x < band->origin.x) ? rect.origin.x : band->origin.x;
+  int16_t top = (rect.origin.y < band->origin.y) ? rect.origin.y : band->origin.y;
+  int16_t right = (rect.origin.x + rect.size.w > band->origin.x + band->size.w) ? rect.origin.x + rect.size.w : band->origin.x + band->size.w;
+  int16_t bottom = (rect.origin.y + rect.size.h > band->origin.y + band->size.h) ? rect.origin.y + rect.size.h : band->origin.y + band->size.h;
+  *band = GRect(left, top, right - left, bottom - top);
+}
 
-    if (drawNPixels > 1) {
-      graphics_draw_line(ctx, GPoint(startPos, yPos), GPoint(startPos + drawNPixels - 1, yPos));
-      
-    } else {
-      graphics_draw_pixel(ctx, GPoint(startPos, yPos));
+// Blackens the shade pattern between startX and endX. Pattern runs start every
+// everyNPixels from startX (or endX when drawing right to left) offset by the
+// line, and a run that starts inside the span is always drawn in full.
+static void drawHorizontalLine(GRect *wipeRect, uint32_t *row, int16_t yPos, int16_t startX, int16_t endX, uint16_t shade, bool drawLeftToRight) {
+  const DitherPattern *pattern = getDitherPattern(shade);
+  int16_t anchorX;
+  int16_t firstX;
+  int16_t lastX;
+  
+  if (drawLeftToRight) {
+    anchorX = startX + (yPos % pattern->everyNPixels);
+    if (anchorX > endX) {
+      return;
     }
     
-    startPos += (everyNPixels * (drawLeftToRight ? 1 : -1));
+    firstX = anchorX;
+    lastX = anchorX + (((endX - anchorX) / pattern->everyNPixels) * pattern->everyNPixels) + pattern->drawNPixels - 1;
+    
+  } else {
+    anchorX = endX + (yPos % pattern->everyNPixels);
+    firstX = anchorX - (((anchorX - startX) / pattern->everyNPixels) * pattern->everyNPixels);
+    lastX = anchorX + pattern->drawNPixels - 1;
+  }
+  
+  // Clip to the wipe layer
+  if (firstX < 0) {
+    firstX = 0;
+  }
+  
+  if (lastX > wipeRect->size.w - 1) {
+    lastX = wipeRect->size.w - 1;
+  }
+  
+  if (firstX <= lastX) {
+    fillSpan(row, wipeRect->origin.x + firstX, wipeRect->origin.x + lastX, 
+             pattern->masks[(wipeRect->origin.x + anchorX) & 3]);
   }
 }
 
-static void greyPixelDistribution(uint16_t shade, int16_t *drawNPixels, int16_t *everyNPixels) {
-  switch (shade) {
-    case 10:
-      *drawNPixels = 1;
-      *everyNPixels = 10;
-      break;
-    
-    case 20:
-      *drawNPixels = 1;
-      *everyNPixels = 5;
-      break;
-    
-    case 25:
-      *drawNPixels = 1;
-      *everyNPixels = 4;
-      break;
-    
-    case 30:
-      *drawNPixels = 3;
-      *everyNPixels = 10;
-      break;
-    
-    case 33:
-      *drawNPixels = 1;
-      *everyNPixels = 3;
-      break;
-    
-    case 40:
-      *drawNPixels = 2;
-      *everyNPixels = 5;
-      break;
-    
-    case 50:
-      *drawNPixels = 1;
-      *everyNPixels = 2;
-      break;
-    
-    case 60:
-      *drawNPixels = 3;
-      *everyNPixels = 5;
-      break;
-    
-    case 66:
-      *drawNPixels = 2;
-      *everyNPixels = 3;
-      break;
-    
-    case 70:
-      *drawNPixels = 7;
-      *everyNPixels = 10;
-      break;
-    
-    case 75:
-      *drawNPixels = 3;
-      *everyNPixels = 4;
-      break;
-    
-    case 80:
-      *drawNPixels = 4;
-      *everyNPixels = 5;
-      break;
-    
-    case 90:
-      *drawNPixels = 9;
-      *everyNPixels = 10;
-      break;
+static void fillSpan(uint32_t *row, int16_t firstX, int16_t lastX, uint32_t blackMask) {
+  int16_t firstWord = firstX >> 5;
+  int16_t lastWord = lastX >> 5;
+  
+  for (int16_t word = firstWord; word <= lastWord; word++) {
+    uint32_t spanMask = 0xffffffff;
+    if (word == firstWord) {
+      spanMask &= 0xffffffff << (firstX & 31);
+    }
     
-    case 100:
-      *drawNPixels = 1;
-      *everyNPixels = 1;
-      break;
+    if (word == lastWord) {
+      spanMask &= 0xffffffff >> (31 - (lastX & 31));
+    }
     
-    default:
-      *drawNPixels = 1;
-      *everyNPixels = 2;
-      break;
+    row[word] &= ~(blackMask & spanMask);
   }
 }
+
+static const DitherPattern *getDitherPattern(uint16_t shade) {
+  for (uint16_t index = 0; index < ARRAY_LENGTH(_ditherPatterns); index++) {
+    if (_ditherPatterns[index].shade == shade) {
+      return &_ditherPatterns[index];
+    }
+  }
+  
+  // Default to 50%
+  return &_ditherPatterns[1];
+}
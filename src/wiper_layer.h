@@ -1,19 +1,55 @@
 #pragma once
 #include "common.h"
   
+// Sweeps of a full wipe, one for each shade.
+#define NUM_SHADES 3
+
 typedef void (*WiperFinishedCallback)(void *callback_data);
 
+typedef struct {
+  uint8_t firstX;
+  uint8_t width;
+} SpriteRow;
+
+// The wiper pre-rotated to one of its stop angles.
+typedef struct {
+  GRect bounds;         // Screen rect covered by the rotated wiper
+  SpriteRow *rows;      // Covered pixels of each line of bounds
+  uint8_t *pixels;      // One bit per covered pixel, set for white, line after line
+} WiperSprite;
+
+// Wipe lines from firstLine up to the next run's firstLine share their shading.
+typedef struct {
+  int16_t firstLine;
+  uint8_t leftShade;    // Shade left of the wiper, 0 for unshaded
+  uint8_t rightShade;   // Shade right of the wiper, 0 for unshaded
+} ShadeRun;
+
+// Each of the wiper's stop angles can split the wipe lines at most once.
+#define WIPER_SHADE_RUNS 11
+
 typedef struct {
   Layer *boltLayer;
   Layer *wipeLayer;
   RotAnimation wiper;
+  Layer *spriteLayer;
+  WiperSprite *sprites;   // NULL when the wiper is rotated live
   uint16_t shadeIndex;
+  uint16_t wipeStep;        // Steps taken since RunWiper
+  time_t wipeStartSeconds;  // When RunWiper started the wipe
+  uint16_t wipeStartMs;
+  GRect wipeRect;
+  ShadeRun shadeRuns[WIPER_SHADE_RUNS];
+  uint8_t numShadeRuns;
+  int32_t shadeAngle;     // Wiper angle the shading was split at
+  GRect shadedBand;       // Lines and columns holding any shading since the last clear
+  GBitmap *shadeCache;    // The wipe lines with their shading drawn, NULL when out of memory
   WiperFinishedCallback finishedCallback;
   void *wiperFinishedCallbackData;
 } WiperLayerData;
 
 WiperLayerData* CreateWiperLayer(Layer *relativeLayer, LayerRelation relation, GRect wipeRect);
 void DrawWiperLayer(WiperLayerData *data);
-void RunWiper(WiperLayerData *data, WiperFinishedCallback finishedCallback, void *wiperFinishedCallbackData);
+void RunWiper(WiperLayerData *data, uint8_t sweeps, WiperFinishedCallback finishedCallback, void *wiperFinishedCallbackData);
 void ClearWiper(WiperLayerData *data);
 void DestroyWiperLayer(WiperLayerData *data);
\ No newline at end of file
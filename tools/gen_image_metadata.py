@@ -0,0 +1,57 @@
+#
+# Generates the image metadata table used to place RotBitmapLayers, from the
+# PNGs listed in appinfo.json. Entries are indexed by RESOURCE_ID_* value,
+# which the SDK assigns in media list order starting at 1.
+#
+# For each image the table holds its size, the side of the square frame a
+# RotBitmapLayer gives it (the integer hypotenuse) and the offset of the
+# unrotated bitmap inside that frame.
+#
+# usage: gen_image_metadata.py <appinfo.json> <resources dir> <out header>
+#
+
+import json
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from pngdecode import load_png
+
+
+def integer_sqrt(value):
+    root = 0
+    while (root + 1) * (root + 1) <= value:
+        root += 1
+    return root
+
+
+def main(appinfo_path, resources_dir, header_path):
+    with open(appinfo_path) as f:
+        media = json.load(f)['resources']['media']
+
+    entries = ['  { { 0, 0 }, 0, { 0, 0 } },    // INVALID_RESOURCE']
+    for item in media:
+        if item['type'] != 'png':
+            entries.append('  { { 0, 0 }, 0, { 0, 0 } },    // %s' % item['name'])
+            continue
+
+        image = load_png(os.path.join(resources_dir, item['file']))
+        hypotenuse = integer_sqrt(image.width * image.width + image.height * image.height)
+
+        # RotBitmapLayer maps the bitmap center onto the frame center.
+        offset_x = hypotenuse // 2 - image.width // 2
+        offset_y = hypotenuse // 2 - image.height // 2
+        entries.append('  { { %d, %d }, %d, { %d, %d } },    // %s' %
+                       (image.width, image.height, hypotenuse, offset_x, offset_y, item['name']))
+
+    header = ['#pragma once',
+              '// Generated by tools/gen_image_metadata.py from appinfo.json. Do not edit.',
+              '',
+              'static const ImageMetadata _imageMetadata[] = {'] + entries + ['};', '']
+
+    with open(header_path, 'w') as f:
+        f.write('\n'.join(header))
+
+
+if __name__ == '__main__':
+    main(*sys.argv[1:4])
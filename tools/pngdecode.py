@@ -0,0 +1,122 @@
+#
+# Minimal PNG reader for the build scripts. Only what the watchface assets
+# need: non-interlaced greyscale, palette and RGB(A) images at 1-8 bits per
+# sample, reduced to a 1-bit white/black pixel grid like the Pebble resource
+# compiler does for the aplite framebuffer.
+#
+
+import struct
+import zlib
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+_CHANNELS = { 0: 1, 2: 3, 3: 1, 4: 2, 6: 4 }
+
+
+class PngImage(object):
+    def __init__(self, width, height, pixels):
+        self.width = width
+        self.height = height
+        # pixels[y][x] is 1 for white, 0 for black
+        self.pixels = pixels
+
+
+def _paeth(a, b, c):
+    p = a + b - c
+    pa = abs(p - a)
+    pb = abs(p - b)
+    pc = abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    if pb <= pc:
+        return b
+    return c
+
+
+def _unfilter(raw, height, stride, bpp):
+    rows = []
+    prev = bytearray(stride)
+    pos = 0
+    for _ in range(height):
+        filter_type = raw[pos]
+        line = bytearray(raw[pos + 1:pos + 1 + stride])
+        pos += stride + 1
+        for i in range(stride):
+            left = line[i - bpp] if i >= bpp else 0
+            up = prev[i]
+            upleft = prev[i - bpp] if i >= bpp else 0
+            if filter_type == 1:
+                line[i] = (line[i] + left) & 0xff
+            elif filter_type == 2:
+                line[i] = (line[i] + up) & 0xff
+            elif filter_type == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xff
+            elif filter_type == 4:
+                line[i] = (line[i] + _paeth(left, up, upleft)) & 0xff
+        rows.append(line)
+        prev = line
+    return rows
+
+
+def _samples(line, width, channels, depth):
+    if depth == 8:
+        return list(line[:width * channels])
+    values = []
+    mask = (1 << depth) - 1
+    for byte in line:
+        for shift in range(8 - depth, -1, -depth):
+            values.append((byte >> shift) & mask)
+    return values[:width * channels]
+
+
+def load_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    if data[:8] != PNG_SIGNATURE:
+        raise ValueError('%s is not a PNG file' % path)
+
+    pos = 8
+    idat = b''
+    palette = None
+    width = height = depth = color_type = None
+    while pos < len(data):
+        length, chunk_type = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += length + 12
+        if chunk_type == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', body)
+            if interlace != 0:
+                raise ValueError('%s: interlaced PNGs are not supported' % path)
+        elif chunk_type == b'PLTE':
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif chunk_type == b'IDAT':
+            idat += body
+        elif chunk_type == b'IEND':
+            break
+
+    if depth > 8:
+        raise ValueError('%s: 16-bit PNGs are not supported' % path)
+
+    channels = _CHANNELS[color_type]
+    stride = (width * channels * depth + 7) // 8
+    bpp = max(1, (channels * depth) // 8)
+    rows = _unfilter(zlib.decompress(idat), height, stride, bpp)
+
+    pixels = []
+    for line in rows:
+        samples = _samples(line, width, channels, depth)
+        row = []
+        for x in range(width):
+            px = samples[x * channels:(x + 1) * channels]
+            if color_type == 3:
+                r, g, b = palette[px[0]]
+            elif color_type in (0, 4):
+                r = g = b = px[0] * 255 // ((1 << depth) - 1)
+            else:
+                r, g, b = px[0], px[1], px[2]
+            luminance = (r * 299 + g * 587 + b * 114) // 1000
+            row.append(1 if luminance >= 128 else 0)
+        pixels.append(row)
+
+    return PngImage(width, height, pixels)